@@ -0,0 +1,88 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Benchmark of payload compression (ratio and CPU time)
+        It does not need Wifi or MQTT, it only runs the compression used by sorba.setCompression(true)
+        on representative SORBA payloads and shows the results in the Serial port
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+// Example of how to measure compression ratio and CPU time
+#include <WiFiClient.h>
+#include "sorbamqtt_wifi.h"
+
+#define BENCH_ITERATIONS 50  // Times each payload is compressed and decompressed to get the average time
+
+char    payload[MQTT_JSON_LIMIT];  // Payload to compress
+uint8_t zip[MQTT_JSON_LIMIT];      // Compressed payload
+uint8_t back[MQTT_JSON_LIMIT];     // Decompressed payload, to verify
+
+// Single message, e.g: {"PV":{"temp":12.5,"press":44.834,"count":4,"text":"example"}}
+void buildSingle() {
+  snprintf(payload, sizeof(payload), "{\"PV\":{\"temp\":12.5,\"press\":44.834,\"count\":4,\"text\":\"example\"}}");
+}
+
+// Batch of messages with timestamp
+void buildBatch(int total) {
+  int pos = snprintf(payload, sizeof(payload), "{\"PV\":[");
+  for (int i = 0; i < total; i++)
+    pos += snprintf(payload + pos, sizeof(payload) - pos, "%s{\"ts\":%ld,\"temp\":%.2f,\"press\":%.3f,\"count\":%d,\"text\":\"example\"}",
+                    i ? "," : "", 1760000000L + i * 5, 20 + 0.05 * i, 101.3 + 0.0612 * i, i);
+  snprintf(payload + pos, sizeof(payload) - pos, "]}");
+}
+
+// Configuration message with many parameters
+void buildConfig() {
+  int pos = snprintf(payload, sizeof(payload), "{\"CFG\":{");
+  for (int i = 0; i < 30; i++)
+    pos += snprintf(payload + pos, sizeof(payload) - pos, "%s\"alarm_hi_%02d\":%d,\"alarm_lo_%02d\":%d,\"enable_%02d\":true",
+                    i ? "," : "", i, 100 + i, i, 10 + i, i);
+  snprintf(payload + pos, sizeof(payload) - pos, "}}");
+}
+
+// Compress and decompress the payload, show size, ratio and average time
+void bench(const char *name) {
+  uint16_t len = strlen(payload);
+  uint16_t zipLen = 0;
+  uint16_t backLen = 0;
+
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS; i++)
+    zipLen = sorbaLzCompress((const uint8_t*) payload, len, zip, sizeof(zip));
+  unsigned long zipTime = (micros() - start) / BENCH_ITERATIONS;
+
+  start = micros();
+  for (int i = 0; i < BENCH_ITERATIONS && zipLen > 0; i++)
+    backLen = sorbaLzDecompress(zip, zipLen, back, sizeof(back));
+  unsigned long backTime = (micros() - start) / BENCH_ITERATIONS;
+
+  bool ok = (zipLen == 0) || (backLen == len && memcmp(back, payload, len) == 0);
+
+  Serial.printf("%-10s size: %5u compressed: %5u ratio: %.2f compress: %5lu us decompress: %5lu us %s\r\n",
+                name, len, zipLen, zipLen ? (float) len / zipLen : 1.0, zipTime, backTime, ok ? "OK" : "ERROR");
+}
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- compression benchmark"); 
+ Serial.println("Compressed 0 means it is sent without compression (not smaller)");
+
+ buildSingle();   bench("single");
+ buildBatch(10);  bench("batch 10");
+ buildBatch(25);  bench("batch 25");
+ buildConfig();   bench("config");
+}
+
+void loop() {
+}
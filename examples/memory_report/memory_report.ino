@@ -0,0 +1,88 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Memory report
+        Shows the memory high water marks and the sizes suggested for MQTT_JSON_LIMIT and MQTT_QUEUE_LIMIT
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+
+// Example of how to get the memory report
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: SORBA Broker u other Public Brokers like "broker.hivemq.com";
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 0;                // MQTT Quality of Service: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+ 
+ #define  SORBA_GROUP    "PV"                 // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB "sorba/data/Asset1"  // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+ #define  MQTT_TOPIC_SUB "sorba/cmd/Asset1"   // Topic for subscribe
+
+ WiFiClient wifiClient;            // Create simple WifiClient object
+
+ SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+ unsigned long lastReport = 0;
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- memory report example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ sorba.subscribe(MQTT_TOPIC_SUB); // Subscribe to receive commands
+
+ sorba.setTimer(1000); // Sending every second
+}
+
+// main loop
+void loop() {
+   String topic;
+
+   // Receive, e.g: {"PV":{"sp":50}}
+   while (sorba.recvMsg(topic)) {
+     float sp;
+     sorba.msgUnpack (SORBA_GROUP, "sp", sp);
+   }
+
+   if (sorba.timerDone()) {
+     sorba.msgInit();
+     sorba.msgPack (SORBA_GROUP, "temp", 20.0 + random(0, 100) / 10.0);
+     sorba.msgPack (SORBA_GROUP, "press", 40.0 + random(0, 100) / 10.0);
+     sorba.msgPack (SORBA_GROUP, "count", (int) sorba.GetTotalPackSent());
+
+     if (!sorba.sendMsg(MQTT_TOPIC_PUB) && sorba.GetLastError() == MQTT_ERR_MSG_TRUNCATED)
+       Serial.println("Message too large, increase MQTT_JSON_LIMIT");
+   }
+
+   // Report every minute, the values are high water marks since starting
+   if (millis() - lastReport >= 60000) {
+     lastReport = millis();
+     sorba.showMemReport();
+     if (sorba.GetLastError() != MQTT_OK) {
+       Serial.print("Last error: "); Serial.println(sorba.GetLastError());
+       sorba.clearLastError();
+     }
+   }
+}
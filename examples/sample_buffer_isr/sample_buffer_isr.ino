@@ -0,0 +1,97 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Sampling in an interrupt (ISR) and sending from the loop
+        The ISR only adds the samples to the acquisition buffer, so sampling never waits for JSON or Wi-Fi
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+
+// Example of how to sample in an ISR
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: SORBA Broker u other Public Brokers like "broker.hivemq.com";
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 0;                // MQTT Quality of Service: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+ 
+ #define  SORBA_GROUP    "PV"                 // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB "sorba/data/Asset1"  // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+
+ #define  PULSE_PIN      4                    // Pin with pulses to count (e.g: flow meter)
+ #define  SAMPLE_TIME    10                   // Sampling time in ms (100 Hz)
+
+ WiFiClient wifiClient;            // Create simple WifiClient object
+
+ SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+ int8_t chLevel;  // Channel for level samples
+ int8_t chPulses; // Channel for pulses count
+
+ volatile int32_t pulses = 0;
+
+// Pulse interrupt: count and add the total as sample
+void IRAM_ATTR onPulse() {
+  pulses++;
+  sorba.pushSample(chPulses, (int32_t) pulses);
+}
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- sampling in ISR example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ // Acquisition buffer for 256 samples and its channels
+ sorba.setSampleBuffer(256);
+ chLevel  = sorba.addSampleChannel(SORBA_GROUP, "level", 2);  // 2 decimal places
+ chPulses = sorba.addSampleChannel(SORBA_GROUP, "pulses");
+
+ pinMode(PULSE_PIN, INPUT_PULLUP);
+ attachInterrupt(digitalPinToInterrupt(PULSE_PIN), onPulse, FALLING);
+
+ sorba.setTimer(1000); // Sending every second
+}
+
+// main loop
+void loop() {
+   static unsigned long lastSample = 0;
+
+   // Sampling at fixed rate, it also can be done from a hardware timer interrupt
+   // It is safe to add samples here while the pulse interrupt also adds them
+   if (millis() - lastSample >= SAMPLE_TIME) {
+     lastSample += SAMPLE_TIME;
+     sorba.pushSample(chLevel, (float) analogRead(A0) * 100.0 / 4095.0); // 0..100 %
+   }
+
+   // Send queued samples, e.g: {"PV":{"level":[45.1,45.2,...],"level_ts":[1000,1010,...]}}
+   // Samples are kept in the buffer when they could not be sent
+   if (sorba.timerDone()) {
+     while (sorba.drainSamples(MQTT_TOPIC_PUB, 32) > 0) {}
+
+     if (sorba.GetSampleOverruns() > 0) {
+       Serial.printf("Samples lost: %u, queued: %u\r\n", sorba.GetSampleOverruns(), sorba.GetSamplesQueued());
+       sorba.resetSampleOverruns();
+     }
+   }
+}
@@ -0,0 +1,80 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Sending arrays (e.g: vibration waveform) to SORBA
+        Large arrays are split in chunk messages that can be joined again by the receiver
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+
+// Example of how to send arrays
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: SORBA Broker u other Public Brokers like "broker.hivemq.com";
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 0;                // MQTT Quality of Service: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+ 
+ #define  SORBA_GROUP    "PV"                 // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB "sorba/data/Asset1"  // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+
+ #define  WAVE_SAMPLES   1024                 // Samples in the waveform
+
+ WiFiClient wifiClient;            // Create simple WifiClient object
+
+ SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+ float wave[WAVE_SAMPLES];  // Waveform samples
+ int   stats[3];            // Small array: min, max, count
+
+// Simulate reading the waveform
+void readWaveform() {
+  for (int i = 0; i < WAVE_SAMPLES; i++)
+    wave[i] = 10.0 * sin(i * 0.05) + random(-100, 100) / 1000.0;
+}
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- sending arrays example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ sorba.setChunkSize(1024); // Max bytes of each chunk message (default 1 KB)
+}
+
+// main loop
+void loop() {
+   readWaveform();
+
+   // Large array: sent in chunks, e.g: {"PV":{"wave":[0.05,0.6,...]},"chunk":{"id":1,"seq":0,"offset":0,"length":1024,"last":false}}
+   sorba.sendArray(MQTT_TOPIC_PUB, SORBA_GROUP, "wave", wave, WAVE_SAMPLES, 3); // 3 decimal places
+
+   // Small array together with other values in the same message, e.g: {"PV":{"stats":[-10,10,1024],"rms":7.07}}
+   stats[0] = -10; stats[1] = 10; stats[2] = WAVE_SAMPLES;
+   sorba.msgInit();
+   sorba.msgPack (SORBA_GROUP, "stats", stats, 3);
+   sorba.msgPack (SORBA_GROUP, "rms", 7.07);
+   sorba.sendMsg(MQTT_TOPIC_PUB); 
+   
+ delay(5000); // Pacing for sending. Can use  sorba.setTimer(time_ms) and bool sorba.timerDone() to control of sending data
+}
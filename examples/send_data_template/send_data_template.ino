@@ -0,0 +1,84 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Sending data to SORBA using a template message
+        The message structure is serialized once and each cycle only the values that changed are written,
+        so the time per cycle depends on the number of values, not on the message size
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+
+// Example of how to send data using a template message
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: SORBA Broker u other Public Brokers like "broker.hivemq.com";
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 0;                // MQTT Quality of Service: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+ 
+ #define  SORBA_GROUP    "PV"                 // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB "sorba/data/Asset1"  // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+
+ WiFiClient wifiClient;            // Create simple WifiClient object
+
+ SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+ // Slots of each value in the template message
+ int16_t slotTemp;
+ int16_t slotPress;
+ int16_t slotCount;
+
+ float temp  = 0.0; // Simulated values
+ float press = 0.0;
+ int   count = 0;
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- sending data using template example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ // Prepare the template once: {"PV":{"temp":null        ,"press":null        ,"count":null        }}
+ sorba.msgTemplateInit();
+ slotTemp  = sorba.msgTemplateAdd (SORBA_GROUP, "temp");                     // Float with default decimal places = 2
+ slotPress = sorba.msgTemplateAdd (SORBA_GROUP, "press", MQTT_TPL_FLOAT, 3); // Float with 3 decimal places
+ slotCount = sorba.msgTemplateAdd (SORBA_GROUP, "count", MQTT_TPL_INT);      // Integer
+}
+
+// main loop
+void loop() {
+   temp  += 0.05;
+   press += 0.0612;
+   count ++;
+
+   // Only the values that changed are written in the template
+   sorba.msgTemplateSet (slotTemp,  temp);
+   sorba.msgTemplateSet (slotPress, press);
+   sorba.msgTemplateSet (slotCount, count);
+
+   // sendTemplateMsg will publish message, e.g: {"PV":{"temp":0.20        ,"press":0.245       ,"count":4           }}
+   // Inside sendTemplateMsg include the checking of Wifi and MQTT connections and reconnect if needed
+   sorba.sendTemplateMsg(MQTT_TOPIC_PUB); 
+   
+ delay(5000); // Pacing for sending. Can use  sorba.setTimer(time_ms) and bool sorba.timerDone() to control of sending data
+}
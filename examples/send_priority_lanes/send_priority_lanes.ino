@@ -0,0 +1,92 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Sending alarms, commands and telemetry by priority
+        Alarms are sent first even when there is a backlog of telemetry messages
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+
+// Example of how to send messages by priority
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: SORBA Broker u other Public Brokers like "broker.hivemq.com";
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 0;                // MQTT Quality of Service: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+ 
+ #define  SORBA_GROUP      "PV"                  // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB   "sorba/data/Asset1"   // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+ #define  MQTT_TOPIC_ALARM "sorba/alarm/Asset1"  // Topic for alarms
+
+ #define  TEMP_HIGH       80.0                   // Alarm limit
+ #define  TELEMETRY_MS    250                    // Telemetry each 250 ms (4 msg/s), under the 5 msg/s of its lane
+
+ WiFiClient wifiClient;            // Create simple WifiClient object
+
+ SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+ bool alarmActive = false;
+ unsigned long lastTelemetry = 0;
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- priority lanes example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ // Alarms: strict priority (default). Control and telemetry share 3:1, telemetry limited to 5 msg/s with burst of 10
+ sorba.setLane(MQTT_LANE_CONTROL, 3);
+ sorba.setLane(MQTT_LANE_TELEMETRY, 1, 5.0, 10);
+
+ sorba.setTimer(10000); // Show metrics every 10 s
+}
+
+// main loop
+void loop() {
+   float temp = 60.0 + random(0, 300) / 10.0; // Simulate reading the temperature
+
+   // Telemetry, e.g: {"PV":{"temp":65.3}}. Faster than the lane rate, the lane fills and new messages are rejected (MQTT_ERR_LANE_FULL)
+   if (millis() - lastTelemetry >= TELEMETRY_MS) {
+     lastTelemetry = millis();
+     sorba.msgInit();
+     sorba.msgPack (SORBA_GROUP, "temp", temp);
+     sorba.queueMsg(MQTT_TOPIC_PUB, MQTT_LANE_TELEMETRY);
+   }
+
+   // Alarm when it changes, sent at once, e.g: {"PV":{"highTemp":true,"temp":85.1}}
+   if ((temp > TEMP_HIGH) != alarmActive) {
+     alarmActive = (temp > TEMP_HIGH);
+     sorba.msgInit();
+     sorba.msgPack (SORBA_GROUP, "highTemp", alarmActive);
+     sorba.msgPack (SORBA_GROUP, "temp", temp);
+     sorba.queueMsg(MQTT_TOPIC_ALARM, MQTT_LANE_ALARM);
+   }
+
+   sorba.sendQueued(10); // Send by priority, messages are kept while Wifi or MQTT is not connected
+
+   if (sorba.timerDone())
+     sorba.showLaneStats();
+
+   delay(100);
+}
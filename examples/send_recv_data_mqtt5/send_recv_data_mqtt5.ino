@@ -0,0 +1,104 @@
+/*
+        Author: Reyan Valdes
+        email: reyanvaldes@yahoo.com
+
+        An example of using SorbaMqttWifi Library - Sending data to SORBA and receive back messages using MQTT 5
+        Repeated topics are sent as 2 bytes Topic Alias and the session is kept in the broker, so reconnecting
+        does not need to subscribe again
+
+        Usage and further info:
+        https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+ Libraries or dependencies have to be installed
+  WiFi         // Wifi (V1.2.7)                  https://docs.arduino.cc/libraries/wifi/
+  PubSubClient // for MQTT Messages (V2.8.0)     https://github.com/knolleary/pubsubclient
+  ArduinoJson  // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
+  UUID         // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
+  ArduinoQueue // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+
+*/
+// Example of how to send data and receive back messages using MQTT 5
+#include <WiFiClient.h>   // For non secure connection include <WifiClient.h> or if using SSL <WiFiClientSecure.h>
+#include "sorbamqtt_wifi.h"
+
+// Init communication parameters
+ char WIFI_SSID[15]     = "SSID";           // Your Wifi SSID
+ char WIFI_PWD[15]      = "PASSWORD";       // Your Password 
+ char MQTT_SERVER[25]   = "broker.emqx.io"; // MQTT Server: must support MQTT 5
+ char MQTT_USERNAME[20] = "";               // MQTT User name (if needed)
+ char MQTT_PASSWORD[20] = "";               // MQTT Password (if needed)
+ char MQTT_CLIENTID[20] = "sorba-node-1";   // Fixed Client ID, must be unique per device. Needed to resume the session after power cycle
+ uint16_t MQTT_PORT     = 1883;             // MQTT Port
+ uint16_t MQTT_QoS      = 1;                // QoS for subscribing: 1 or 2 to have received messages kept in the session while disconnected. Publishing is always QoS 0
+ uint32_t MQTT_SESSION  = 3600;             // Session Expiry in seconds: broker keeps subscriptions this time after disconnection
+ 
+ #define  SORBA_GROUP    "PV"                 // Group will used in Sorba structure: <Asset>.<Group>
+ #define  MQTT_TOPIC_PUB "sorba/data/Asset1"  // Topic for publish <SORBA_MAIN_TOPIC>/<SORBA_ASSET>;
+ #define  MQTT_TOPIC_SUB "sorba/data/Asset1Back" // Topic used for subscribing 
+ 
+WiFiClient wifiClient;            // Create simple WifiClient object
+
+SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
+
+String topic;   // Topic used when receiving messages from MQTT Broker
+
+float temp = 0.0; // Simulated values
+int   count = 0;
+
+void setup() {
+ // Setup Serial speed for monitoring 
+ Serial.begin(115200);   // Set baudrate
+ Serial.println("SORBA- sending data using MQTT 5 example"); 
+
+ // connect to Wifi
+ sorba.connectWifi(WIFI_SSID, WIFI_PWD); // It will kep trying until get connection to the Wifi, otherwise cannot do anything
+
+ // MQTT 5 settings, must be set before connect
+ sorba.setProtocol(MQTT_PROTOCOL_V5);   // Use MQTT 5 instead of MQTT 3.1.1 (PubSubClient)
+ sorba.setSessionExpiry(MQTT_SESSION);  // Keep the session in the broker after disconnection
+ sorba.setClientID(MQTT_CLIENTID);      // Same Client ID is required to resume the session
+ 
+ // Connect to MQTT Broker with username & password
+ sorba.connect(MQTT_SERVER, MQTT_PORT, MQTT_USERNAME, MQTT_PASSWORD, MQTT_QoS);  // Has a retry of 3 times for the connection to the MQTT broker
+
+ // Show MQTT connection status
+ if (sorba.isConnected())
+  Serial.println("MQTT connection OK");
+ else
+  Serial.println("MQTT connection Failed");
+
+ // Subscribe only when the broker did not resume the session, otherwise the subscription is already there
+ // (the library also subscribes again by itself when reconnecting and the session was lost)
+ if (!sorba.sessionPresent())
+  sorba.subscribe(MQTT_TOPIC_SUB);
+}
+
+// main loop
+void loop() {
+   temp += 0.05;
+   count ++;
+ 
+   // Prepare the message and packing all parameters values
+   sorba.msgInit(); // Clear any previous message from memory, this must be called initially to prepare the JSON object correctly
+   sorba.msgPack (SORBA_GROUP, "temp",  temp);   // Will use default decimal places = 2, can change with setFloatDecimals(#)
+   sorba.msgPack (SORBA_GROUP, "count", count);  // Adding integer to the JSON message
+
+   // sendMsg will publish message, e.g: {"PV":{"temp":0.2,"count":4}}
+   // First time the topic is sent with an alias, next times only the 2 bytes alias is sent
+   sorba.sendMsg(MQTT_TOPIC_PUB); 
+
+   Serial.print("Total bytes saved by Topic Alias: "); Serial.println(sorba.GetTotalBytesSaved());
+
+  // Check if there are messages in queue and parse it automatically
+  while (sorba.recvMsg(topic)) { // if there are messages pending, parse it, e.g: {"PV": {"ad": 60.5, "run": 1}}
+     float ad =0.0; 
+     short run = 0;
+     Serial.print("Received Msg Topic: "); Serial.print(topic);
+     sorba.msgUnpack (SORBA_GROUP, "ad", ad);       // Transferring from JSON msg already parsed to each parameter values 
+     sorba.msgUnpack (SORBA_GROUP, "run", run); 
+     Serial.printf("ad: %f",ad);
+     Serial.printf(", run: %i\r\n", run);
+   }
+   
+ delay(5000); // Pacing for sending. Can use  sorba.setTimer(time_ms) and bool sorba.timerDone() to control of sending data
+}
@@ -74,7 +74,7 @@ CAUw7C29C79Fv1C5qfPrmAESrciIxpg0X40KPMbp1ZWVbd4=
 // "-----END CERTIFICATE-----\n";
 
 
-WiFiClient wifiClient;            // Create simple WifiClient object
+WiFiClientSecure wifiClient;      // Create secure WifiClient object
 
 SorbaMqttWifi sorba(wifiClient); // Create main SORBA object to allow connection,  send or receive messages using MQTT
 
@@ -134,6 +134,7 @@ void setup() {
  Serial.println();
 
  wifiClient.setTrustAnchors(&cert);  // Verify Server TLS (one way)
+ sorba.setTlsSession(wifiClient);    // Keep the TLS session, so reconnecting resumes it instead of full handshake
 #else // for ESP32- Here the time is ignore for TSL certificate checking
  wifiClient.setCACert(root_ca);  // Verify Server TLS (one way)
 #endif
@@ -143,6 +144,11 @@ void setup() {
 // wifiClient.setCertificate(client_ca); // Identify Self for mTLS
 // wifiClient.setPrivateKey(client_key); // Sign for Self for mTLS
 
+ // Fast reconnect: next connections join directly the last AP (BSSID, channel), IP from DHCP
+ // To reuse the IP lease too (IP reserved in the router): sorba.setFastReconnect(true, true);
+ // To keep it after power cycle, save it in EEPROM: EEPROM.begin(512); sorba.setFastReconnect(true, false, 0); 
+ sorba.setFastReconnect(true);
+
  // connect to Wifi
  sorba.connectWifi(WIFI_SSID, WIFI_PWD);  // It will kep trying until get connection to the Wifi, otherwise cannot do anything
  
@@ -156,6 +162,8 @@ void setup() {
  else
   Serial.println("MQTT connection Failed");
 
+ sorba.showConnTiming(); // Time of each phase: WiFi join, DHCP, TCP/TLS and MQTT
+
  // Subscribe to a topic to receive messages back
  sorba.subscribe(MQTT_TOPIC_SUB);
 
@@ -0,0 +1,136 @@
+#include "sorbalz.h"
+
+// Lightweight LZ compression (LZSS) for MQTT payloads in boards like ESP32, ESP8266
+// SORBOTICS
+// https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+#define SORBA_LZ_HASH_SIZE   (1 << SORBA_LZ_HASH_BITS)
+#define SORBA_LZ_WINDOW      4096  // Max distance for a match
+#define SORBA_LZ_MIN_MATCH   3
+#define SORBA_LZ_MAX_MATCH   18
+#define SORBA_LZ_NO_POS      0xFFFF
+
+static uint16_t lzHead[SORBA_LZ_HASH_SIZE]; // Last position for each hash, kept global to avoid using the stack
+
+static inline uint16_t lzHash(const uint8_t *p) {
+  uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (uint16_t)((uint32_t)(v * 2654435761UL) >> (32 - SORBA_LZ_HASH_BITS));
+}
+
+//********************************************************************************
+// Compress in[0..inLen) into out, return the compressed size or 0 if it does not fit in outMax or it is not smaller
+uint16_t sorbaLzCompress(const uint8_t *in, uint16_t inLen, uint8_t *out, uint16_t outMax) {
+  if (inLen == 0 || outMax < SORBA_LZ_HEADER + 2)
+    return 0;
+
+  for (uint16_t i = 0; i < SORBA_LZ_HASH_SIZE; i++)
+    lzHead[i] = SORBA_LZ_NO_POS;
+
+  out[0] = SORBA_LZ_MAGIC0;
+  out[1] = SORBA_LZ_MAGIC1;
+  out[2] = SORBA_LZ_MAGIC2;
+  out[3] = SORBA_LZ_VERSION;
+  out[4] = inLen >> 8;
+  out[5] = inLen & 0xFF;
+
+  uint16_t outPos = SORBA_LZ_HEADER;
+  uint16_t flagPos = 0;
+  uint8_t  flagBit = 8; // force a new flag byte for the first item
+  uint16_t pos = 0;
+
+  while (pos < inLen) {
+    if (flagBit == 8) { // start a new group of 8 items
+      if (outPos >= outMax) return 0;
+      flagPos = outPos++;
+      out[flagPos] = 0;
+      flagBit = 0;
+    }
+
+    uint16_t matchLen = 0;
+    uint16_t matchDist = 0;
+
+    if (pos + SORBA_LZ_MIN_MATCH <= inLen) {
+      uint16_t h = lzHash(in + pos);
+      uint16_t cand = lzHead[h];
+      lzHead[h] = pos;
+
+      if (cand != SORBA_LZ_NO_POS && pos - cand <= SORBA_LZ_WINDOW) {
+        uint16_t maxLen = inLen - pos;
+        if (maxLen > SORBA_LZ_MAX_MATCH) maxLen = SORBA_LZ_MAX_MATCH;
+        while (matchLen < maxLen && in[cand + matchLen] == in[pos + matchLen])
+          matchLen++;
+        matchDist = pos - cand;
+      }
+    }
+
+    if (matchLen >= SORBA_LZ_MIN_MATCH) {
+      if (outPos + 2 > outMax) return 0;
+      uint16_t d = matchDist - 1;
+      out[outPos++] = d >> 4;
+      out[outPos++] = ((d & 0x0F) << 4) | (matchLen - SORBA_LZ_MIN_MATCH);
+      out[flagPos] |= (1 << flagBit);
+
+      // Insert the positions inside the match, so next matches can refer to them
+      for (uint16_t i = pos + 1; i < pos + matchLen && i + SORBA_LZ_MIN_MATCH <= inLen; i++)
+        lzHead[lzHash(in + i)] = i;
+
+      pos += matchLen;
+    }
+    else {
+      if (outPos >= outMax) return 0;
+      out[outPos++] = in[pos++];
+    }
+
+    flagBit++;
+  }
+
+  if (outPos >= inLen) // compression does not help
+    return 0;
+
+  return outPos;
+}
+
+//********************************************************************************
+// Decompress in[0..inLen) into out, return the original size or 0 if the payload is not valid or does not fit in outMax
+uint16_t sorbaLzDecompress(const uint8_t *in, uint16_t inLen, uint8_t *out, uint16_t outMax) {
+  if (!sorbaLzIsCompressed(in, inLen) || in[3] != SORBA_LZ_VERSION)
+    return 0;
+
+  uint16_t origLen = ((uint16_t)in[4] << 8) | in[5];
+  if (origLen > outMax)
+    return 0;
+
+  uint16_t inPos = SORBA_LZ_HEADER;
+  uint16_t outPos = 0;
+
+  while (outPos < origLen) {
+    if (inPos >= inLen) return 0;
+    uint8_t flags = in[inPos++];
+
+    for (uint8_t bit = 0; bit < 8 && outPos < origLen; bit++) {
+      if (flags & (1 << bit)) { // match
+        if (inPos + 2 > inLen) return 0;
+        uint16_t dist = (((uint16_t)in[inPos] << 4) | (in[inPos+1] >> 4)) + 1;
+        uint16_t len  = (in[inPos+1] & 0x0F) + SORBA_LZ_MIN_MATCH;
+        inPos += 2;
+        if (dist > outPos || outPos + len > origLen) return 0;
+        for (uint16_t i = 0; i < len; i++, outPos++) // byte by byte, the match can overlap the output
+          out[outPos] = out[outPos - dist];
+      }
+      else { // literal
+        if (inPos >= inLen) return 0;
+        out[outPos++] = in[inPos++];
+      }
+    }
+  }
+
+  return origLen;
+}
+
+//********************************************************************************
+// Check if the payload has the compressed header
+bool sorbaLzIsCompressed(const uint8_t *in, uint16_t inLen) {
+  return inLen >= SORBA_LZ_HEADER && in[0] == SORBA_LZ_MAGIC0 && in[1] == SORBA_LZ_MAGIC1 && in[2] == SORBA_LZ_MAGIC2;
+}
+
+//********************************************************************************
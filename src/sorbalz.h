@@ -0,0 +1,34 @@
+#ifndef SORBALZ_H
+#define SORBALZ_H
+
+// Lightweight LZ compression (LZSS) for MQTT payloads in boards like ESP32, ESP8266
+// Window is limited to 4 KB (whole MQTT message), so decompression does not need more memory than the output
+// SORBOTICS
+// https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+// Compressed payload format:
+//  Header (6 bytes): 0xFF 'S' 'Z' <version> <original length high> <original length low>
+//  Body: groups of 1 flag byte + 8 items. Flag bit (LSB first) 0: literal byte, 1: match of 2 bytes
+//        match: 12 bits distance-1 and 4 bits length-3 (length 3..18, distance 1..4096)
+// 0xFF is not valid in UTF-8 text, so it can not be confused with a JSON payload
+
+#include <Arduino.h>
+
+#define SORBA_LZ_MAGIC0      0xFF
+#define SORBA_LZ_MAGIC1      'S'
+#define SORBA_LZ_MAGIC2      'Z'
+#define SORBA_LZ_VERSION     1
+#define SORBA_LZ_HEADER      6     // Header size in bytes
+#define SORBA_LZ_HASH_BITS   8     // Hash table of 2^bits positions (512 bytes RAM for 8 bits, 10 bits improves ratio ~10% using 2 KB)
+#define SORBA_LZ_MIN_SIZE    128   // Payloads smaller than this are sent without compression by default
+
+// Compress in[0..inLen) into out, return the compressed size or 0 if it does not fit in outMax or it is not smaller
+uint16_t sorbaLzCompress(const uint8_t *in, uint16_t inLen, uint8_t *out, uint16_t outMax);
+
+// Decompress in[0..inLen) into out, return the original size or 0 if the payload is not valid or does not fit in outMax
+uint16_t sorbaLzDecompress(const uint8_t *in, uint16_t inLen, uint8_t *out, uint16_t outMax);
+
+// Check if the payload has the compressed header
+bool sorbaLzIsCompressed(const uint8_t *in, uint16_t inLen);
+
+#endif
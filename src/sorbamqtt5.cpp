@@ -0,0 +1,532 @@
+#include "sorbamqtt_wifi.h"
+
+// Minimal MQTT 5 client used by SorbaMqttWifi when the protocol is set to MQTT_PROTOCOL_V5
+// SORBOTICS
+// https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+// MQTT 5 control packets (fixed header first byte)
+#define MQTT5_CONNECT     0x10
+#define MQTT5_CONNACK     0x20
+#define MQTT5_PUBLISH     0x30
+#define MQTT5_PUBACK      0x40
+#define MQTT5_PUBREC      0x50
+#define MQTT5_PUBREL      0x62  // PUBREL has reserved flags 0010
+#define MQTT5_PUBCOMP     0x70
+#define MQTT5_SUBSCRIBE   0x82  // SUBSCRIBE has reserved flags 0010
+#define MQTT5_SUBACK      0x90
+#define MQTT5_PINGREQ     0xC0
+#define MQTT5_PINGRESP    0xD0
+#define MQTT5_DISCONNECT  0xE0
+
+// MQTT 5 properties used by this client
+#define MQTT5_PROP_SESSION_EXPIRY    0x11
+#define MQTT5_PROP_SERVER_KEEPALIVE  0x13
+#define MQTT5_PROP_TOPIC_ALIAS_MAX   0x22
+#define MQTT5_PROP_TOPIC_ALIAS       0x23
+
+//********************************************************************************
+
+SorbaMqtt5Client::SorbaMqtt5Client (Client& aClient) : _client(&aClient)
+{// constructor
+}
+
+//********************************************************************************
+// Connect to the broker. With Session Expiry > 0 Clean Start is not set, so the broker can resume the session
+// and the subscriptions are kept in the broker (no need to subscribe again)
+bool SorbaMqtt5Client::connect(const char* id, const char* user, const char* pass) {
+
+    if (!_client->connected()) {
+      if (!_client->connect(domain, port_)) {
+        _state = MQTT_CONNECT_FAILED;
+        return false;
+      }
+    }
+
+    bool hasUser = (user != NULL) && (strlen(user) > 0);
+    bool hasPass = (pass != NULL) && (strlen(pass) > 0);
+
+    // Variable header: protocol name, version, flags, keep alive and properties
+    uint16_t pos = writeString("MQTT", buffer, 0);
+    buffer[pos++] = 5; // Protocol version MQTT 5
+
+    uint8_t flags = 0;
+    if (sessionExpiry == 0) flags |= 0x02; // Clean Start
+    if (hasUser) flags |= 0x80;
+    if (hasPass) flags |= 0x40;
+    buffer[pos++] = flags;
+    buffer[pos++] = keepAlive >> 8;
+    buffer[pos++] = keepAlive & 0xFF;
+
+    if (sessionExpiry > 0) {
+      buffer[pos++] = 5; // Properties length
+      buffer[pos++] = MQTT5_PROP_SESSION_EXPIRY;
+      buffer[pos++] = (sessionExpiry >> 24) & 0xFF;
+      buffer[pos++] = (sessionExpiry >> 16) & 0xFF;
+      buffer[pos++] = (sessionExpiry >> 8) & 0xFF;
+      buffer[pos++] = sessionExpiry & 0xFF;
+    }
+    else
+      buffer[pos++] = 0; // No properties
+
+    // Payload: client ID, user name and password
+    pos = writeString(id, buffer, pos);
+    if (hasUser) pos = writeString(user, buffer, pos);
+    if (hasPass) pos = writeString(pass, buffer, pos);
+
+    if (!sendPacket(MQTT5_CONNECT, buffer, pos)) {
+      _client->stop();
+      _state = MQTT_CONNECT_FAILED;
+      return false;
+    }
+
+    // Wait for CONNACK
+    unsigned long start = millis();
+    while (!_client->available()) {
+      if (millis() - start >= socketTimeout * 1000UL) {
+        _client->stop();
+        _state = MQTT_CONNECTION_TIMEOUT;
+        return false;
+      }
+      delay(10);
+    }
+
+    uint8_t header = 0;
+    uint32_t len = readPacket(header);
+    if ((header & 0xF0) != MQTT5_CONNACK || len < 2) {
+      _client->stop();
+      _state = MQTT_CONNECT_FAILED;
+      return false;
+    }
+
+    handleConnack(len);
+    if (_state != MQTT_CONNECTED) {
+      _client->stop();
+      return false;
+    }
+
+    lastInActivity = lastOutActivity = millis();
+    pingOutstanding = false;
+    aliasCount = 0; // Topic Aliases are not kept between network connections
+
+    if (!_sessionPresent) // broker has no session for us, then subscribe again
+      resubscribe();
+
+    return true;
+}
+
+//********************************************************************************
+// Parse CONNACK: session present, reason code and properties
+void SorbaMqtt5Client::handleConnack(uint32_t len) {
+    _sessionPresent = buffer[0] & 0x01;
+
+    switch (buffer[1]) { // Map the MQTT 5 reason codes to the same states used by PubSubClient
+     case 0x00: _state = MQTT_CONNECTED; break;
+     case 0x84: _state = MQTT_CONNECT_BAD_PROTOCOL; break;
+     case 0x85: _state = MQTT_CONNECT_BAD_CLIENT_ID; break;
+     case 0x86: _state = MQTT_CONNECT_BAD_CREDENTIALS; break;
+     case 0x87: _state = MQTT_CONNECT_UNAUTHORIZED; break;
+     case 0x88: _state = MQTT_CONNECT_UNAVAILABLE; break;
+     default:   _state = MQTT_CONNECT_FAILED; break;
+    }
+
+    aliasMax = 0; // Topic Alias Maximum is 0 when the broker does not send it
+    uint32_t pos = 2;
+    uint32_t propLen = 0;
+    if (len <= pos || !readVarInt(buffer, len, pos, propLen))
+      return;
+
+    uint32_t end = pos + propLen;
+    if (end > len) end = len;
+    while (pos < end) {
+      uint8_t id = buffer[pos++];
+      if (id == MQTT5_PROP_TOPIC_ALIAS_MAX && pos + 2 <= end) {
+        aliasMax = (buffer[pos] << 8) | buffer[pos+1];
+        if (aliasMax > MQTT5_TOPIC_ALIAS_LIMIT) aliasMax = MQTT5_TOPIC_ALIAS_LIMIT;
+        pos += 2;
+      }
+      else if (id == MQTT5_PROP_SERVER_KEEPALIVE && pos + 2 <= end) {
+        keepAlive = (buffer[pos] << 8) | buffer[pos+1]; // Broker requested a different keep alive
+        pos += 2;
+      }
+      else if (!skipProperty(id, buffer, end, pos))
+        break;
+    }
+}
+
+//********************************************************************************
+// Disconnect from the broker, the session is kept when Session Expiry > 0
+void SorbaMqtt5Client::disconnect() {
+    uint8_t reason[2] = {0x00, 0x00}; // Normal disconnection, no properties
+    sendPacket(MQTT5_DISCONNECT, reason, sizeof(reason));
+    _client->flush();
+    _client->stop();
+    _state = MQTT_DISCONNECTED;
+}
+
+//********************************************************************************
+// Is it connected to the broker?
+bool SorbaMqtt5Client::connected() {
+    if (_client->connected())
+      return _state == MQTT_CONNECTED;
+
+    if (_state == MQTT_CONNECTED) {
+      _state = MQTT_CONNECTION_LOST;
+      _client->stop();
+    }
+    return false;
+}
+
+//********************************************************************************
+// Publish the payload. The first time a topic is published it is sent with a new alias, next times only the alias is sent
+bool SorbaMqtt5Client::publish(const char* topic, const char* payload, uint16_t qos) {
+    return publish(topic, (const uint8_t*) payload, strlen(payload), qos);
+}
+
+//********************************************************************************
+// Publish binary payload with the length given
+bool SorbaMqtt5Client::publish(const char* topic, const uint8_t* payload, uint32_t length, uint16_t qos) {
+    if (!connected())
+      return false;
+
+    qos = 0; // QoS 1 and 2 are not supported for publishing: there is no in-flight storage to resend after reconnecting
+
+    uint16_t topicLen = strlen(topic);
+    uint16_t alias = 0;
+    bool     aliasOnly = false;
+
+    if (topicLen < MQTT5_TOPIC_LIMIT) {
+      for (uint16_t i = 0; i < aliasCount; i++) {
+        if (strcmp(aliasTopic[i], topic) == 0) {
+          alias = i + 1;
+          aliasOnly = true;
+          break;
+        }
+      }
+      if (alias == 0 && aliasCount < aliasMax) { // Set a new alias for this topic
+        strcpy(aliasTopic[aliasCount], topic);
+        aliasCount++;
+        alias = aliasCount;
+      }
+    }
+
+    if ((uint32_t)topicLen + MQTT5_HEADER_LIMIT > MQTT5_BUFFER_LIMIT)
+      return false;
+
+    // Variable header: topic (empty when the alias is already known by the broker), packet id and properties
+    uint16_t pos = writeString(aliasOnly ? "" : topic, buffer, 0); // no packet id with QoS 0
+    if (alias > 0) {
+      buffer[pos++] = 3; // Properties length
+      buffer[pos++] = MQTT5_PROP_TOPIC_ALIAS;
+      buffer[pos++] = alias >> 8;
+      buffer[pos++] = alias & 0xFF;
+    }
+    else
+      buffer[pos++] = 0; // No properties
+
+    bool result = sendPacket(MQTT5_PUBLISH, buffer, pos, payload, length);
+
+    if (result && alias > 0) {
+      if (aliasOnly) {
+        aliasBytesSaved += topicLen - 3; // topic not sent, but 3 bytes for the alias property
+        aliasHits++;
+      }
+      else
+        aliasBytesSaved -= 3; // first publish includes both topic and alias
+    }
+
+    return result;
+}
+
+//********************************************************************************
+// Subscribe to a topic, the topic is remembered to subscribe again if the broker lost the session
+bool SorbaMqtt5Client::subscribe(const char* topic, uint16_t qos) {
+    uint16_t topicLen = strlen(topic);
+    if (qos > 2) qos = 2;
+
+    bool found = false;
+    for (uint16_t i = 0; i < subCount; i++) {
+      if (strcmp(subTopic[i], topic) == 0) {
+        subQoS[i] = qos;
+        found = true;
+        break;
+      }
+    }
+    if (!found && subCount < MQTT5_SUB_LIMIT && topicLen < MQTT5_TOPIC_LIMIT) {
+      strcpy(subTopic[subCount], topic);
+      subQoS[subCount] = qos;
+      subCount++;
+    }
+
+    if (!connected() || (uint32_t)topicLen + MQTT5_HEADER_LIMIT > MQTT5_BUFFER_LIMIT)
+      return false;
+
+    uint16_t id = nextPacketId();
+    uint16_t pos = 0;
+    buffer[pos++] = id >> 8;
+    buffer[pos++] = id & 0xFF;
+    buffer[pos++] = 0; // No properties
+    pos = writeString(topic, buffer, pos);
+    buffer[pos++] = qos; // Subscription options
+
+    return sendPacket(MQTT5_SUBSCRIBE, buffer, pos);
+}
+
+//********************************************************************************
+// Subscribe again to all topics remembered
+void SorbaMqtt5Client::resubscribe() {
+    for (uint16_t i = 0; i < subCount; i++) {
+      char topic[MQTT5_TOPIC_LIMIT];
+      strcpy(topic, subTopic[i]); // subscribe() writes the buffer, work with a copy
+      subscribe(topic, subQoS[i]);
+    }
+}
+
+//********************************************************************************
+// Process incoming packets and keep alive, it has to be called frequently
+bool SorbaMqtt5Client::loop() {
+    if (!connected())
+      return false;
+
+    unsigned long now = millis();
+    unsigned long keepAliveMs = keepAlive * 1000UL;
+
+    if (keepAliveMs > 0 && ((now - lastInActivity > keepAliveMs) || (now - lastOutActivity > keepAliveMs))) {
+      if (pingOutstanding) { // No answer from the broker for the last ping
+        _state = MQTT_CONNECTION_TIMEOUT;
+        _client->stop();
+        return false;
+      }
+      sendPacket(MQTT5_PINGREQ, NULL, 0);
+      lastInActivity = now;
+      pingOutstanding = true;
+    }
+
+    while (_client->available()) {
+      uint8_t header = 0;
+      uint32_t len = readPacket(header);
+      lastInActivity = millis();
+
+      switch (header & 0xF0) {
+       case MQTT5_PUBLISH:
+         handlePublish(header, len);
+         break;
+       case MQTT5_PUBREC: // QoS 2 publish sent: release it
+         if (len >= 2) sendAck(MQTT5_PUBREL, (buffer[0] << 8) | buffer[1]);
+         break;
+       case (MQTT5_PUBREL & 0xF0): // QoS 2 publish received: complete it
+         if (len >= 2) sendAck(MQTT5_PUBCOMP, (buffer[0] << 8) | buffer[1]);
+         break;
+       case MQTT5_PINGRESP:
+         pingOutstanding = false;
+         break;
+       case MQTT5_DISCONNECT: // Disconnected by the broker
+         _client->stop();
+         _state = MQTT_DISCONNECTED;
+         return false;
+       default: // PUBACK, PUBCOMP, SUBACK, nothing to do
+         break;
+      }
+
+      if (!connected())
+        return false;
+    }
+
+    return true;
+}
+
+//********************************************************************************
+// Incoming PUBLISH: give the topic (null terminated) and payload to the callback and send the ack based on QoS
+void SorbaMqtt5Client::handlePublish(uint8_t header, uint32_t len) {
+    uint8_t qos = (header >> 1) & 0x03;
+    if (len < 2)
+      return;
+
+    uint16_t topicLen = (buffer[0] << 8) | buffer[1];
+    uint32_t pos = 2 + topicLen;
+    uint16_t id = 0;
+    if (pos > len)
+      return;
+
+    if (qos > 0) {
+      if (pos + 2 > len) return;
+      id = (buffer[pos] << 8) | buffer[pos+1];
+      pos += 2;
+    }
+
+    uint32_t propLen = 0;
+    if (!readVarInt(buffer, len, pos, propLen) || pos + propLen > len)
+      return;
+    pos += propLen;
+
+    // Move the topic 2 bytes back, so there is room to terminate it with null
+    memmove(buffer, buffer + 2, topicLen);
+    buffer[topicLen] = '\0';
+
+    if (callback)
+      callback((char*) buffer, buffer + pos, len - pos);
+
+    if (qos == 1)
+      sendAck(MQTT5_PUBACK, id);
+    else if (qos == 2)
+      sendAck(MQTT5_PUBREC, id);
+}
+
+//********************************************************************************
+// Send PUBACK, PUBREC, PUBREL or PUBCOMP with success reason code (omitted)
+bool SorbaMqtt5Client::sendAck(uint8_t type, uint16_t id) {
+    uint8_t ack[2] = {(uint8_t)(id >> 8), (uint8_t)(id & 0xFF)};
+    return sendPacket(type, ack, sizeof(ack));
+}
+
+//********************************************************************************
+// Packet Id can not be 0
+uint16_t SorbaMqtt5Client::nextPacketId() {
+    packetId++;
+    if (packetId == 0) packetId = 1;
+    return packetId;
+}
+
+//********************************************************************************
+// Write the fixed header (type and remaining length) followed by the body in two parts
+bool SorbaMqtt5Client::sendPacket(uint8_t header, const uint8_t *part1, uint32_t len1, const uint8_t *part2, uint32_t len2) {
+    uint8_t fixed[5];
+    fixed[0] = header;
+    uint16_t pos = writeVarInt(len1 + len2, fixed, 1);
+
+    bool result = _client->write(fixed, pos) == pos;
+    if (result && len1 > 0) result = _client->write(part1, len1) == len1;
+    if (result && len2 > 0) result = _client->write(part2, len2) == len2;
+
+    lastOutActivity = millis();
+    return result;
+}
+
+//********************************************************************************
+// Read one byte waiting up to socket timeout
+bool SorbaMqtt5Client::readByte(uint8_t &value) {
+    unsigned long start = millis();
+    while (!_client->available()) {
+      if (millis() - start >= socketTimeout * 1000UL)
+        return false;
+      yield();
+    }
+    value = _client->read();
+    return true;
+}
+
+//********************************************************************************
+// Read full packet in buffer. Packets larger than buffer are discarded (header returned as 0)
+uint32_t SorbaMqtt5Client::readPacket(uint8_t &header) {
+    if (!readByte(header)) {
+      header = 0;
+      return 0;
+    }
+
+    uint32_t len = 0;
+    uint32_t multiplier = 1;
+    uint8_t  digit = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+      if (!readByte(digit)) {
+        header = 0;
+        return 0;
+      }
+      len += (digit & 0x7F) * multiplier;
+      multiplier *= 128;
+      if ((digit & 0x80) == 0) break;
+    }
+
+    bool fits = len <= MQTT5_BUFFER_LIMIT;
+    for (uint32_t i = 0; i < len; i++) {
+      uint8_t value;
+      if (!readByte(value)) {
+        header = 0;
+        return 0;
+      }
+      if (fits) buffer[i] = value;
+    }
+
+    if (!fits) {
+      Serial.println("MQTT5 packet too large, discarded");
+      header = 0;
+      return 0;
+    }
+
+    return len;
+}
+
+//********************************************************************************
+// Write UTF-8 string with 2 bytes length
+uint16_t SorbaMqtt5Client::writeString(const char* text, uint8_t *buf, uint16_t pos) {
+    uint16_t len = strlen(text);
+    buf[pos++] = len >> 8;
+    buf[pos++] = len & 0xFF;
+    memcpy(buf + pos, text, len);
+    return pos + len;
+}
+
+//********************************************************************************
+// Write Variable Byte Integer
+uint16_t SorbaMqtt5Client::writeVarInt(uint32_t value, uint8_t *buf, uint16_t pos) {
+    do {
+      uint8_t digit = value % 128;
+      value /= 128;
+      if (value > 0) digit |= 0x80;
+      buf[pos++] = digit;
+    } while (value > 0);
+    return pos;
+}
+
+//********************************************************************************
+// Read Variable Byte Integer from buffer
+bool SorbaMqtt5Client::readVarInt(uint8_t *buf, uint32_t len, uint32_t &pos, uint32_t &value) {
+    value = 0;
+    uint32_t multiplier = 1;
+    for (uint8_t i = 0; i < 4; i++) {
+      if (pos >= len) return false;
+      uint8_t digit = buf[pos++];
+      value += (digit & 0x7F) * multiplier;
+      multiplier *= 128;
+      if ((digit & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+//********************************************************************************
+// Skip a property not used by this client based on its type
+bool SorbaMqtt5Client::skipProperty(uint8_t id, uint8_t *buf, uint32_t len, uint32_t &pos) {
+    uint32_t size = 0;
+    switch (id) {
+     case 0x01: case 0x17: case 0x19: case 0x24: case 0x25: case 0x28: case 0x29: case 0x2A:
+       size = 1; // Byte
+       break;
+     case 0x13: case 0x21: case 0x22: case 0x23:
+       size = 2; // Two Byte Integer
+       break;
+     case 0x02: case 0x11: case 0x18: case 0x27:
+       size = 4; // Four Byte Integer
+       break;
+     case 0x0B: { // Variable Byte Integer
+       uint32_t value;
+       return readVarInt(buf, len, pos, value);
+     }
+     case 0x03: case 0x08: case 0x09: case 0x12: case 0x15: case 0x16: case 0x1A: case 0x1C: case 0x1F:
+       if (pos + 2 > len) return false; // UTF-8 string or binary data
+       size = 2 + ((buf[pos] << 8) | buf[pos+1]);
+       break;
+     case 0x26: { // User property: string pair
+       if (pos + 2 > len) return false;
+       uint32_t first = 2 + ((buf[pos] << 8) | buf[pos+1]);
+       if (pos + first + 2 > len) return false;
+       size = first + 2 + ((buf[pos+first] << 8) | buf[pos+first+1]);
+       break;
+     }
+     default:
+       return false; // Unknown property
+    }
+
+    if (pos + size > len) return false;
+    pos += size;
+    return true;
+}
+
+//********************************************************************************
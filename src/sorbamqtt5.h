@@ -0,0 +1,103 @@
+#ifndef SORBAMQTT5_H
+#define SORBAMQTT5_H
+
+// Minimal MQTT 5 client used by SorbaMqttWifi when the protocol is set to MQTT_PROTOCOL_V5
+// It keeps the same calls used from PubSubClient (setServer, connect, publish, subscribe, loop ...)
+// and add Topic Aliases (publish repeated topics with 2 bytes alias) and persistent sessions (Session Expiry)
+// SORBOTICS
+// https://github.com/reyanvaldes/SorbaMQTT-Wifi
+
+#include <Arduino.h>
+#include <Client.h>
+#include <PubSubClient.h>  // Only used for MQTT_* state constants, so showState() works for both protocols
+
+#define MQTT5_HEADER_LIMIT       128 // Room for fixed header, topic and properties on top of the payload
+#define MQTT5_BUFFER_LIMIT       (MQTT_JSON_LIMIT + MQTT5_HEADER_LIMIT) // Buffer for incoming packets
+#define MQTT5_TOPIC_LIMIT        64  // Max topic length that can be stored for Topic Alias or subscription
+#define MQTT5_TOPIC_ALIAS_LIMIT  8   // Max Topic Aliases used by this client for publishing
+#define MQTT5_SUB_LIMIT          5   // Max subscriptions remembered to resubscribe when the session is not resumed
+
+typedef void (*callbackMQTT5) (char* topic, byte* payload, unsigned int length);
+
+class SorbaMqtt5Client
+{
+  public:
+   SorbaMqtt5Client (Client& aClient);
+
+   void setServer(const char* server, uint16_t port) {domain = server; port_= port;}
+
+   void setKeepAlive(uint16_t time) {keepAlive = time;}  // Keep alive in seconds
+
+   void setSocketTimeout(uint16_t time) {socketTimeout = time;} // Socket timeout in seconds
+
+   void setCallback(callbackMQTT5 acallback) {callback = acallback;}
+
+   void setSessionExpiry(uint32_t time) {sessionExpiry = time;} // Session Expiry in seconds, 0: session ends when disconnected
+
+   bool connect(const char* id, const char* user, const char* pass); // Connect using Clean Start only when there is no Session Expiry
+
+   void disconnect(); // Disconnect keeping the session in the Broker if Session Expiry > 0
+
+   bool connected();
+
+   int state() {return _state;}
+
+   bool sessionPresent() {return _sessionPresent;} // Broker resumed the previous session in last connect
+
+   bool publish(const char* topic, const char* payload, uint16_t qos); // Publish using Topic Alias when possible. Always QoS 0, qos is ignored
+
+   bool publish(const char* topic, const uint8_t* payload, uint32_t length, uint16_t qos); // Publish binary payload (e.g: compressed). Always QoS 0
+
+   bool subscribe(const char* topic, uint16_t qos=0); // Subscribe and remember the topic for resubscribing
+
+   bool loop(); // Process incoming packets and keep alive
+
+   int32_t getAliasBytesSaved() {return aliasBytesSaved;} // Total bytes saved by Topic Aliases
+
+   uint32_t getAliasHits() {return aliasHits;} // Total publishes sent with alias only (no topic)
+
+  private:
+   bool     readByte(uint8_t &value);
+   uint32_t readPacket(uint8_t &header); // Read full packet in buffer, return the remaining length
+   bool     sendPacket(uint8_t header, const uint8_t *part1, uint32_t len1, const uint8_t *part2=NULL, uint32_t len2=0); // Fixed header plus body in two parts
+   uint16_t writeString(const char* text, uint8_t *buf, uint16_t pos);
+   uint16_t writeVarInt(uint32_t value, uint8_t *buf, uint16_t pos);
+   bool     readVarInt(uint8_t *buf, uint32_t len, uint32_t &pos, uint32_t &value);
+   bool     skipProperty(uint8_t id, uint8_t *buf, uint32_t len, uint32_t &pos);
+   void     handleConnack(uint32_t len);
+   void     handlePublish(uint8_t header, uint32_t len);
+   bool     sendAck(uint8_t type, uint16_t id);
+   uint16_t nextPacketId();
+   void     resubscribe();
+
+   Client*  _client;
+   const char* domain = NULL;
+   uint16_t port_ = 1883;
+   uint16_t keepAlive = 15;
+   uint16_t socketTimeout = 15;
+   uint32_t sessionExpiry = 0;
+   callbackMQTT5 callback = NULL;
+
+   int      _state = MQTT_DISCONNECTED;
+   bool     _sessionPresent = false;
+   bool     pingOutstanding = false;
+   uint16_t packetId = 0;
+   unsigned long lastOutActivity = 0;
+   unsigned long lastInActivity = 0;
+
+   // Topic Aliases are valid only for the current network connection
+   uint16_t aliasMax = 0;   // Min of the broker Topic Alias Maximum and MQTT5_TOPIC_ALIAS_LIMIT
+   uint16_t aliasCount = 0;
+   char     aliasTopic[MQTT5_TOPIC_ALIAS_LIMIT][MQTT5_TOPIC_LIMIT];
+   int32_t  aliasBytesSaved = 0;
+   uint32_t aliasHits = 0;
+
+   // Subscriptions to restore when the broker did not resume the session
+   uint16_t subCount = 0;
+   char     subTopic[MQTT5_SUB_LIMIT][MQTT5_TOPIC_LIMIT];
+   uint8_t  subQoS[MQTT5_SUB_LIMIT];
+
+   uint8_t  buffer[MQTT5_BUFFER_LIMIT];
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "sorbamqtt_wifi.h"
+#include <new> // std::nothrow
 
 // Class for Sending data to SORBA using MQTT using Wifi in boards like ESP32, ESP8266
 // SORBOTICS
@@ -27,10 +28,87 @@
 
 // PubSubClient client(wifiClient); // Simple MQTT client
 
-DynamicJsonDocument _jsDoc (MQTT_JSON_LIMIT); // Working with JSON doc for both sending MQTT messages or subscribing
+// Allocator for the JSON doc keeping the bytes in use and the peak. Each block has its size before it
+union tAllocHeader {
+  size_t size;
+  double align; // keep the alignment of malloc
+};
+
+class SorbaJsonAllocator : public Allocator {
+  public:
+   void* allocate(size_t size) override {
+     tAllocHeader *block = (tAllocHeader*) malloc(sizeof(tAllocHeader) + size);
+     if (block == NULL)
+       return NULL;
+     block->size = size;
+     inUse(size);
+     return block + 1;
+   }
+
+   void deallocate(void* ptr) override {
+     if (ptr == NULL)
+       return;
+     tAllocHeader *block = (tAllocHeader*) ptr - 1;
+     used -= block->size;
+     free(block);
+   }
+
+   void* reallocate(void* ptr, size_t size) override {
+     if (ptr == NULL)
+       return allocate(size);
+     tAllocHeader *block = (tAllocHeader*) ptr - 1;
+     size_t oldSize = block->size;
+     block = (tAllocHeader*) realloc(block, sizeof(tAllocHeader) + size);
+     if (block == NULL) // old block is still valid
+       return NULL;
+     block->size = size;
+     used -= oldSize;
+     inUse(size);
+     return block + 1;
+   }
+
+   void inUse(size_t size) {
+     used += size;
+     if (used > peak)
+       peak = used;
+   }
+
+   size_t used = 0;
+   size_t peak = 0;
+};
+
+SorbaJsonAllocator jsonAllocator; // Has to be created before the JSON doc
+
+JsonDocument _jsDoc (&jsonAllocator); // Working with JSON doc for both sending MQTT messages or subscribing
 
 ArduinoQueue <tSubMsg> subMsgQueue (MQTT_QUEUE_LIMIT); // Queue to receive subscription messages
 
+uint16_t subMsgQueuePeak = 0;    // Max messages waiting in the queue
+
+uint32_t subMsgQueueDropped = 0; // Messages lost because the queue was full
+
+volatile unsigned long wifiAssocTime = 0; // Time when the station joined the AP (before DHCP), set by Wifi event
+
+#if defined (ESP8266)
+ WiFiEventHandler wifiAssocHandler; // Handler has to be kept while the event is used
+#endif
+
+// Register Wifi event to get the time when it joins the AP, so join and DHCP times can be measured apart
+void wifiEventsInit() {
+  static bool done = false;
+  if (done) return;
+  done = true;
+#if defined (ESP8266)
+  wifiAssocHandler = WiFi.onStationModeConnected([](const WiFiEventStationModeConnected &event) {
+    wifiAssocTime = millis();
+  });
+#else
+  WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info) {
+    wifiAssocTime = millis();
+  }, ARDUINO_EVENT_WIFI_STA_CONNECTED);
+#endif
+}
+
 void defCallback(char* topic, byte* payload, unsigned int length) {  // Calling back for subscription
 
    Serial.print("Message arrived topic: ");
@@ -44,7 +122,10 @@ void defCallback(char* topic, byte* payload, unsigned int length) {  // Calling
     msgPayload += (char)payload[i];
    } // for
    
-   Serial.print(msgPayload);
+   if (sorbaLzIsCompressed(payload, length))
+    Serial.print("(compressed)");
+   else
+    Serial.print(msgPayload);
    Serial.print(", Len: "); Serial.println(length);
 
    // Setup msg to be ready insert in a queue
@@ -53,12 +134,17 @@ void defCallback(char* topic, byte* payload, unsigned int length) {  // Calling
    msg.payload = msgPayload;
 
    // insert msg into the queue to be consumed by the application any time
-   subMsgQueue.enqueue(msg);   
+   if (!subMsgQueue.enqueue(msg)) {
+    subMsgQueueDropped++;
+    Serial.println("Receiving queue full, message lost (MQTT_QUEUE_LIMIT)");
+   }
+   else if (subMsgQueue.itemCount() > subMsgQueuePeak)
+    subMsgQueuePeak = subMsgQueue.itemCount();
   } // callback
 
 //********************************************************************************
 
-SorbaMqttWifi::SorbaMqttWifi (Client& awifiClient) : client(awifiClient)
+SorbaMqttWifi::SorbaMqttWifi (Client& awifiClient) : client(awifiClient), netClient(&awifiClient)
 {// constructor
     setCallback(defCallback); // Set default callback for MQTT subscribing msg
 }
@@ -73,13 +159,31 @@ bool SorbaMqttWifi::connect(char mqtt_Server[], uint16_t mqtt_Port, char userNam
     strncpy(mqttUserName, userName, sizeof(mqttUserName));
     strncpy(mqttPassword, password, sizeof(mqttPassword));
 
-    UUID     uuid;  // create the instance for UUID
-    strncpy(mqttClientID, uuid.toCharArray(), sizeof(mqttClientID)); // It is important to copy validating its max limit to avoid overflow
+    if (!mqttFixedClientID) { // MQTT 5 sessions are resumed only with the same Client ID, see setClientID
+     UUID     uuid;  // create the instance for UUID
+     strncpy(mqttClientID, uuid.toCharArray(), sizeof(mqttClientID)); // It is important to copy validating its max limit to avoid overflow
+    }
     
     return connect();
 }
 
 
+//********************************************************************************
+// Select the MQTT protocol. The MQTT 5 client (with its packet buffer) is allocated only first time it is selected
+bool SorbaMqttWifi::setProtocol(uint8_t protocol) {
+  if (protocol == MQTT_PROTOCOL_V5 && client5 == NULL) {
+    client5 = new (std::nothrow) SorbaMqtt5Client(*netClient);
+    if (client5 == NULL) {
+      Serial.println("Not enough memory for MQTT 5 client");
+      mqttProtocol = MQTT_PROTOCOL_V311;
+      return false;
+    }
+  }
+
+  mqttProtocol = protocol;
+  return true;
+}
+
 //********************************************************************************
 // Connect to the MQTT broker
 bool SorbaMqttWifi::connect() {
@@ -88,17 +192,49 @@ bool SorbaMqttWifi::connect() {
     Serial.print(" MQTT port: "); Serial.println(mqttPort); 
     Serial.print("MQTT Client ID: "); Serial.print(mqttClientID); 
     Serial.print(" MQTT User: "); Serial.println(mqttUserName); 
-    client.setServer(mqttServer, mqttPort);
-    client.setKeepAlive(mqttKeepAlive);
-    client.setSocketTimeout(mqttSocketTimeout);
-    client.setCallback(callback);
+    if (mqttProtocol == MQTT_PROTOCOL_V5) {
+     Serial.println("MQTT protocol: 5");
+     client5->setServer(mqttServer, mqttPort);
+     client5->setKeepAlive(mqttKeepAlive);
+     client5->setSocketTimeout(mqttSocketTimeout);
+     client5->setCallback(callback);
+     client5->setSessionExpiry(mqttSessionExpiry);
+    }
+    else {
+     if (client.getBufferSize() < MQTT_JSON_LIMIT + MQTT5_HEADER_LIMIT) // Default buffer (256 bytes) is too small for large messages or array chunks
+      client.setBufferSize(MQTT_JSON_LIMIT + MQTT5_HEADER_LIMIT);
+     client.setServer(mqttServer, mqttPort);
+     client.setKeepAlive(mqttKeepAlive);
+     client.setSocketTimeout(mqttSocketTimeout);
+     client.setCallback(callback);
+    }
     
     uint16_t count =0;
     
     while (!isConnected() && (count <retryLimit)) {
+      // Network connection first (TCP and TLS handshake for WiFiClientSecure), so each phase time can be measured
+      unsigned long start = millis();
+      if (!netClient->connected() && !netClient->connect(mqttServer, mqttPort)) {
+       connTiming.netConnect = millis() - start;
+       Serial.println("MQTT network connection failed, try again in short time");
+       delay(500);
+       count += 1;
+       continue;
+      }
+      connTiming.netConnect = millis() - start;
+      
+      start = millis();
   // (mqttClientID, mqttUserName, mqttPassword)
-      if (client.connect(mqttClientID, mqttUserName, mqttPassword)) {// This has to be unique otherwise has conflict with other client and could make connection lost
+      bool connected;
+      if (mqttProtocol == MQTT_PROTOCOL_V5)
+       connected = client5->connect(mqttClientID, mqttUserName, mqttPassword); // With Session Expiry it resumes the session and skip subscribing again
+      else
+       connected = client.connect(mqttClientID, mqttUserName, mqttPassword); // This has to be unique otherwise has conflict with other client and could make connection lost
+      connTiming.mqttConnect = millis() - start;
+      if (connected) {
         showState(); 
+        if (sessionPresent())
+         Serial.println("MQTT session resumed");
         startTimer(); // for timer control
         return true;
       }
@@ -118,6 +254,8 @@ bool SorbaMqttWifi::connect() {
 //********************************************************************************
 // Return the MQTT state
 int SorbaMqttWifi::state() {
+    if (mqttProtocol == MQTT_PROTOCOL_V5)
+     return client5->state();
     return client.state();
 }
 
@@ -125,12 +263,17 @@ int SorbaMqttWifi::state() {
 // Disconnect from MQTT broker
 void SorbaMqttWifi::disconnect() {
     Serial.println("MQTT disconnecting"); 
-    client.disconnect();
+    if (mqttProtocol == MQTT_PROTOCOL_V5)
+     client5->disconnect(); // The session is kept in the broker if Session Expiry > 0
+    else
+     client.disconnect();
    };
    
 //********************************************************************************
 // Is it connected to the Broker?
  bool SorbaMqttWifi::SorbaMqttWifi::isConnected() {
+  if (mqttProtocol == MQTT_PROTOCOL_V5)
+   return client5->connected();
   return client.connected();
 }
 
@@ -157,7 +300,7 @@ void SorbaMqttWifi::showState() {
     Serial.print("MQTT State=");
     Serial.print(state());
     Serial.print(" Text: ");
-    switch (client.state()) {
+    switch (state()) {
     case MQTT_CONNECTED:
       // Client is connected
       Serial.println("MQTT client connected");
@@ -220,15 +363,52 @@ bool SorbaMqttWifi::connectWifi(String wifi_ssid, String wifi_pwd)
 }
 
 //********************************************************************************
-// Connect to Wifi with retry loop
+// Connect to Wifi with retry loop. With fast reconnect it first tries the cached BSSID, channel and IP (no scan, no DHCP)
 bool SorbaMqttWifi::connectWifi() {
+      wifiEventsInit(); // to measure the join time apart from DHCP
+      
+      unsigned long start = millis();
+      wifiAssocTime = 0;
+      connTiming.fastJoin = false;
+      bool connected = false;
+
+      if (wifiFastEnabled && wifiCache.magic == WIFI_CACHE_MAGIC) {
+       Serial.print("Fast connecting to WiFi => "); Serial.print(wifiSSID);
+       Serial.print(" channel: "); Serial.print(wifiCache.channel);
+       if (wifiFastStaticIP) // Reuse last IP lease, skip DHCP
+        WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway), IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+       WiFi.begin(wifiSSID, wifiPwd, wifiCache.channel, wifiCache.bssid); // Direct join to the last AP, no scanning
+       connected = waitWifi(WIFI_FAST_TIMEOUT);
+
+       if (connected)
+        connTiming.fastJoin = true;
+       else { // AP changed or not available, do full connection
+        Serial.println(" fast connection failed");
+        wifiCache.magic = 0;
+        WiFi.disconnect();
+        if (wifiFastStaticIP)
+         WiFi.config(IPAddress(0,0,0,0), IPAddress(0,0,0,0), IPAddress(0,0,0,0)); // back to DHCP
+       }
+      }
+
+      if (!connected) {
     // perform connection
-      WiFi.begin(wifiSSID, wifiPwd);
-      Serial.print("Connecting to WiFi => "); Serial.print(wifiSSID);
-      while (WiFi.status() != WL_CONNECTED) {
-       Serial.print('.');
-       delay(1000);
+       WiFi.begin(wifiSSID, wifiPwd);
+       Serial.print("Connecting to WiFi => "); Serial.print(wifiSSID);
+       waitWifi(0); // It will kep trying until get connection
       }
+
+      // Time for each phase, join includes the failed fast connection if any
+      unsigned long now = millis();
+      if (wifiAssocTime != 0 && wifiAssocTime >= start) {
+       connTiming.wifiJoin = wifiAssocTime - start;
+       connTiming.wifiDhcp = now - wifiAssocTime;
+      }
+      else { // join time not available, DHCP included
+       connTiming.wifiJoin = now - start;
+       connTiming.wifiDhcp = 0;
+      }
+
       Serial.println("");
       Serial.println("WiFi connected");
       Serial.print("IP address: ");
@@ -236,9 +416,78 @@ bool SorbaMqttWifi::connectWifi() {
       Serial.print("MAC address: ");
       Serial.println(WiFi.macAddress()); 
 
+      if (wifiFastEnabled)
+       wifiCacheUpdate(); // keep the AP and IP for next connection
+
       return true;
    }
 
+//********************************************************************************
+// Wait for Wifi connection up to timeout ms (0: forever), return true if it is connected
+bool SorbaMqttWifi::waitWifi(unsigned long timeout) {
+      unsigned long start = millis();
+      unsigned long lastDot = start;
+      while (WiFi.status() != WL_CONNECTED) {
+       if (timeout > 0 && millis() - start >= timeout)
+        return false;
+       if (millis() - lastDot >= 1000) {
+        Serial.print('.');
+        lastDot = millis();
+       }
+       delay(WIFI_POLL_TIME);
+      }
+      return true;
+   }
+
+//********************************************************************************
+// Enable fast reconnect. staticIP: reuse the last IP lease without DHCP. The lease time is not known, so only use it
+// when the router reserves the IP for this device, otherwise after a long power off the IP could be given to other device
+// eepromAddr >= 0: save the cache in EEPROM to keep it after power cycle (application has to call EEPROM.begin first)
+void SorbaMqttWifi::setFastReconnect(bool enable, bool staticIP, int eepromAddr) {
+      wifiFastEnabled = enable;
+      wifiFastStaticIP = staticIP;
+      wifiCacheAddr = eepromAddr;
+
+      if (enable && eepromAddr >= 0 && wifiCache.magic != WIFI_CACHE_MAGIC) {
+       EEPROM.get(eepromAddr, wifiCache); // Load the cache saved before power cycle
+       if (wifiCache.magic != WIFI_CACHE_MAGIC)
+        memset(&wifiCache, 0, sizeof(wifiCache));
+      }
+   }
+
+//********************************************************************************
+// Keep the current AP (BSSID, channel) and IP lease, it is saved in EEPROM only if it changed
+void SorbaMqttWifi::wifiCacheUpdate() {
+      tWifiCache cache;
+      memset(&cache, 0, sizeof(cache));
+      cache.magic   = WIFI_CACHE_MAGIC;
+      memcpy(cache.bssid, WiFi.BSSID(), sizeof(cache.bssid));
+      cache.channel = WiFi.channel();
+      cache.ip      = WiFi.localIP();
+      cache.gateway = WiFi.gatewayIP();
+      cache.subnet  = WiFi.subnetMask();
+      cache.dns     = WiFi.dnsIP();
+
+      if (memcmp(&cache, &wifiCache, sizeof(cache)) == 0)
+       return; // same AP and IP, nothing to save
+
+      wifiCache = cache;
+      if (wifiCacheAddr >= 0) { // write flash only when it changed
+       EEPROM.put(wifiCacheAddr, wifiCache);
+       EEPROM.commit();
+      }
+   }
+
+//********************************************************************************
+// Show in Serial the time of each connection phase
+void SorbaMqttWifi::showConnTiming() {
+      Serial.print("Connection time (ms) WiFi join: "); Serial.print(connTiming.wifiJoin);
+      Serial.print(connTiming.fastJoin ? " (fast)" : "");
+      Serial.print(" DHCP: "); Serial.print(connTiming.wifiDhcp);
+      Serial.print(" TCP/TLS: "); Serial.print(connTiming.netConnect);
+      Serial.print(" MQTT: "); Serial.println(connTiming.mqttConnect);
+   }
+
  //********************************************************************************
  // Disconnect from Wifi
    void SorbaMqttWifi::disconnectWifi() {
@@ -321,17 +570,35 @@ double SorbaMqttWifi::roundToDec( double in_value, uint16_t decimal_place)
 // Send MQTT message, the payload should be a valid JSON
 bool SorbaMqttWifi::sendMsg(char topic[]){ // Send the message, need to call first msgInit and msgPack
     
+    if (!msgToChar()) // Serializing the JSON, convert JSON msg to char [] 
+      return false;
+    
+    return sendText(topic, mqttMsg);
+   }
+
+//********************************************************************************
+// Send a message already serialized, checking Wifi and MQTT connections first
+bool SorbaMqttWifi::sendText(char topic[], char msg[]){
+    
     checkConnectionWifi(); // Check Wifi Connection, if there is a problem, will reconnect
     
     checkConnection(); // Check MQTT connection, if there is a problem, will reconnect
    
     if (isConnected()) { // If it is connected to MQTT Broker, send the message
       
-      client.loop(); // take the change and process the callback when subscribing
-      
-      msgToChar(); // Serializing the JSON, convert JSON msg to char [] 
+      mqttLoop(); // take the change and process the callback when subscribing
+
+      uint16_t len = strlen(msg);
+      if (len > memStats.msgPeak)
+        memStats.msgPeak = len;
+      checkMemory();
       
-      bool result =  client.publish( topic, mqttMsg, mqttQoS);  // Publish the MQTT message based on the QoS defined: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
+      bool result;
+      uint16_t zipLen = msgCompress(msg); // Compress if it is enabled and the message is large enough
+      if (zipLen > 0)
+       result = mqttPublish( topic, mqttZip, zipLen);
+      else
+       result = mqttPublish( topic, (const uint8_t*) msg, strlen(msg));  // Publish the MQTT message based on the QoS defined: 0: At Most Once ("Fire and Forget"),1: At Least Once (Acknowledged), 2: Exactly Once (Assured)
       if (result)
       {
 	   totalPackSent ++;  // Increment total packages sent
@@ -358,6 +625,24 @@ bool SorbaMqttWifi::sendMsg(char topic[], uint16_t mqtt_qos)
   return result;
 }
 
+//********************************************************************************
+// Publish using the MQTT client for the protocol selected
+bool SorbaMqttWifi::mqttPublish(char topic[], const uint8_t payload[], unsigned int length) {
+  if (mqttProtocol == MQTT_PROTOCOL_V5)
+   return client5->publish(topic, payload, length, mqttQoS); // Repeated topics are sent as 2 bytes Topic Alias, always QoS 0
+  
+  return client.publish(topic, payload, length, mqttQoS); // PubSubClient publishes QoS 0, this parameter is the retained flag
+}
+
+//********************************************************************************
+// Process the MQTT client for the protocol selected
+bool SorbaMqttWifi::mqttLoop() {
+  if (mqttProtocol == MQTT_PROTOCOL_V5)
+   return client5->loop();
+  
+  return client.loop();
+}
+
 //********************************************************************************
 // Receive message from Subscribing
 bool SorbaMqttWifi::recvMsg(String &topic, String &payload ) { 
@@ -366,11 +651,18 @@ bool SorbaMqttWifi::recvMsg(String &topic, String &payload ) {
     topic.clear();
     payload.clear();
     
-    client.loop(); // take the change and process the callback when subscribing
+    mqttLoop(); // take the change and process the callback when subscribing
+
+    checkQueue();
 
     if (!subMsgQueue.isEmpty())
     {
       tSubMsg msg = subMsgQueue.dequeue();  // extract the msg from queue
+      if (!msgInflate(msg.payload)) // decompress if it is compressed
+        return false;
+      if (msg.payload.length() > memStats.recvPeak)
+        memStats.recvPeak = msg.payload.length();
+      checkMemory();
       topic = msg.topic;
       payload = msg.payload;
 	  
@@ -390,16 +682,20 @@ bool SorbaMqttWifi::recvMsg(String &topic) {
     topic.clear();
     _jsDoc.clear();
     
-    client.loop(); // take the change and process the callback when subscribing
+    mqttLoop(); // take the change and process the callback when subscribing
+
+    checkQueue();
 
     if (!subMsgQueue.isEmpty())
     {
       tSubMsg msg = subMsgQueue.dequeue();  // extract the msg from queue
+      if (!msgInflate(msg.payload)) // decompress if it is compressed
+        return false;
+      if (msg.payload.length() > memStats.recvPeak)
+        memStats.recvPeak = msg.payload.length();
       topic = msg.topic;
-      DeserializationError error = deserializeJson(_jsDoc, msg.payload);
 
-      if (error) {
-        Serial.print("deserializeJson() failed: "); Serial.println(error.c_str());
+      if (!parseMsg(msg.payload)) {
         topic.clear();
         _jsDoc.clear();
         return false;
@@ -416,9 +712,16 @@ bool SorbaMqttWifi::recvMsg(String &topic) {
 bool SorbaMqttWifi::parseMsg(String msg) { 
   
    DeserializationError error = deserializeJson(_jsDoc, msg);
+   checkMemory();
    
    if (error) {
 	Serial.print("deserializeJson() failed: "); Serial.println(error.c_str());
+	if (error == DeserializationError::NoMemory) {
+	  memStats.noMemory++;
+	  lastError = MQTT_ERR_JSON_NOMEMORY;
+	}
+	else
+	  lastError = MQTT_ERR_JSON_INVALID;
 	return false;
    }
    
@@ -426,4 +729,725 @@ bool SorbaMqttWifi::parseMsg(String msg) {
 }
 
 //********************************************************************************
+// Enable or disable compression of sent payloads. The buffer is allocated only first time it is enabled
+bool SorbaMqttWifi::setCompression(bool enable, uint16_t minSize) {
+  if (enable && mqttZip == NULL) {
+    mqttZip = (uint8_t*) malloc(MQTT_JSON_LIMIT);
+    if (mqttZip == NULL) {
+      Serial.println("Not enough memory for compression");
+      mqttZipEnabled = false;
+      return false;
+    }
+  }
+
+  mqttZipEnabled = enable;
+  mqttZipMinSize = minSize;
+  return true;
+}
+
+//********************************************************************************
+// Compress msg into mqttZip, return the compressed size or 0 when the message has to be sent as is
+uint16_t SorbaMqttWifi::msgCompress(char msg[]) {
+  if (!mqttZipEnabled)
+    return 0;
+
+  uint16_t len = strlen(msg);
+  if (len < mqttZipMinSize)
+    return 0;
+
+  uint16_t zipLen = sorbaLzCompress((const uint8_t*) msg, len, mqttZip, MQTT_JSON_LIMIT); // 0 if it is not smaller
+  if (zipLen > 0)
+    totalZipSaved += len - zipLen;
+
+  return zipLen;
+}
+
+//********************************************************************************
+// Decompress the payload if it is compressed (header 0xFF 'S' 'Z'), using mqttMsg as working buffer
+bool SorbaMqttWifi::msgInflate(String &payload) {
+  if (!sorbaLzIsCompressed((const uint8_t*) payload.c_str(), payload.length()))
+    return true; // not compressed, nothing to do
+
+  uint16_t len = sorbaLzDecompress((const uint8_t*) payload.c_str(), payload.length(), (uint8_t*) mqttMsg, sizeof(mqttMsg) - 1);
+  if (len == 0) {
+    lastError = MQTT_ERR_ZIP_INVALID;
+    Serial.println("Decompress payload failed");
+    return false;
+  }
+
+  mqttMsg[len] = '\0';
+  payload = mqttMsg;
+  return true;
+}
+
+//********************************************************************************
+// Start a new template: {"group":{"param":<value>,...}} with fixed room for each value, so next cycles only write the values
+void SorbaMqttWifi::msgTemplateInit() {
+  strcpy(mqttTpl, "{}");
+  mqttTplLen = 2;
+  mqttTplSlots = 0;
+}
+
+//********************************************************************************
+// Add a value to the template, return the slot used by msgTemplateSet or -1 if there is no room
+// type: MQTT_TPL_FLOAT (with decimals), MQTT_TPL_INT or MQTT_TPL_BOOL, width: chars reserved for the value
+int16_t SorbaMqttWifi::msgTemplateAdd(char group[], char param[], uint8_t type, uint16_t dec, uint8_t width) {
+  if (mqttTplSlots >= MQTT_TEMPLATE_SLOTS) {
+    Serial.println("Template has no more slots");
+    return -1;
+  }
+
+  if (width < 5) width = 5; // room for null or false
+  if (dec == 0) dec = mqttFloatDecimals;
+
+  uint16_t groupLen = strlen(group);
+  uint16_t paramLen = strlen(param);
+
+  // Find the group: "group":{
+  char *groupStart = NULL;
+  for (char *p = mqttTpl; groupLen > 0 && (p = strstr(p, group)) != NULL; p++) {
+    if (p > mqttTpl && *(p-1) == '"' && strncmp(p + groupLen, "\":{", 3) == 0) {
+      groupStart = p;
+      break;
+    }
+  }
+  bool newGroup = (groupLen > 0) && (groupStart == NULL);
+
+  uint16_t at; // position in the template to insert
+  if (groupStart != NULL) // group exists, insert before its closing }
+    at = strchr(groupStart, '}') - mqttTpl;
+  else
+    at = mqttTplLen - 1; // insert before the closing } of the message
+
+  bool comma = (mqttTpl[at-1] != '{');
+  uint16_t len = (comma ? 1 : 0) + (newGroup ? groupLen + 5 : 0) + paramLen + 3 + width; // ,"group":{"param":<value>}
+
+  if (mqttTplLen + len >= MQTT_TEMPLATE_LIMIT) {
+    Serial.println("Template is too large, increase MQTT_TEMPLATE_LIMIT");
+    return -1;
+  }
+
+  // Move the rest of the template and the slots after it to make room
+  memmove(mqttTpl + at + len, mqttTpl + at, mqttTplLen - at + 1);
+  mqttTplLen += len;
+
+  for (uint16_t i = 0; i < mqttTplSlots; i++)
+    if (tplSlot[i].pos >= at)
+      tplSlot[i].pos += len;
+
+  char *p = mqttTpl + at;
+  if (comma) *p++ = ',';
+  if (newGroup) {
+    *p++ = '"'; memcpy(p, group, groupLen); p += groupLen;
+    memcpy(p, "\":{", 3); p += 3;
+  }
+  *p++ = '"'; memcpy(p, param, paramLen); p += paramLen;
+  memcpy(p, "\":", 2); p += 2;
+  uint16_t valuePos = p - mqttTpl;
+  memcpy(p, "null", 4); // value is null until it is set
+  memset(p + 4, ' ', width - 4); // JSON allows spaces after the value
+  p += width;
+  if (newGroup) *p++ = '}';
+
+  tTplSlot &slot = tplSlot[mqttTplSlots];
+  slot.pos   = valuePos;
+  slot.width = width;
+  slot.dec   = dec;
+  slot.type  = type;
+  slot.valid = false;
+  slot.last  = 0;
+
+  return mqttTplSlots++;
+}
+
+//********************************************************************************
+// Write the value in its slot only if it changed. Return false if the slot is not valid or the value does not fit (set as null)
+bool SorbaMqttWifi::msgTemplateSet(int16_t slotId, double value) {
+  if (slotId < 0 || slotId >= mqttTplSlots)
+    return false;
+
+  tTplSlot &slot = tplSlot[slotId];
+  if (slot.type == MQTT_TPL_FLOAT)
+    value = roundToDec(value, slot.dec);
+
+  if (slot.valid && slot.last == value) // same value, nothing to write
+    return true;
+
+  char text[32];
+  int len;
+  if (slot.type == MQTT_TPL_BOOL)
+    len = snprintf(text, sizeof(text), "%s", (value != 0) ? "true" : "false");
+  else if (isnan(value) || isinf(value)) // not valid in JSON
+    len = snprintf(text, sizeof(text), "null");
+  else if (slot.type == MQTT_TPL_INT)
+    len = snprintf(text, sizeof(text), "%ld", (long) value);
+  else
+    len = snprintf(text, sizeof(text), "%.*f", slot.dec, value);
+
+  bool result = true;
+  if (len < 0 || len >= (int) sizeof(text) || len > slot.width) { // does not fit (snprintf returns the length needed), set as null to avoid sending an old value
+    Serial.println("Template value does not fit, increase the width");
+    len = snprintf(text, sizeof(text), "null");
+    result = false;
+  }
+
+  memcpy(mqttTpl + slot.pos, text, len);
+  memset(mqttTpl + slot.pos + len, ' ', slot.width - len);
+  slot.valid = result;
+  slot.last  = value;
+
+  return result;
+}
+
+//********************************************************************************
+// Send the template message with the current values
+bool SorbaMqttWifi::sendTemplateMsg(char topic[]) {
+  return sendText(topic, mqttTpl);
+}
+
+//********************************************************************************
+// Write the int value as text, return the length
+uint16_t SorbaMqttWifi::formatValue(char out[], int value, uint16_t dec) {
+  return snprintf(out, 32, "%d", value);
+}
+
+//********************************************************************************
+// Write the value as text with decimals, without trailing zeros to keep the message small, return the length
+uint16_t SorbaMqttWifi::formatValue(char out[], double value, uint16_t dec) {
+  if (isnan(value) || isinf(value)) { // not valid in JSON
+    strcpy(out, "null");
+    return 4;
+  }
+
+  int len = snprintf(out, 32, "%.*f", dec, value);
+  if (len <= 0 || len >= 32) { // too large for the text
+    strcpy(out, "null");
+    return 4;
+  }
+
+  if (dec > 0) { // remove trailing zeros and the dot: 1.50 -> 1.5, 2.00 -> 2
+    while (len > 1 && out[len-1] == '0') len--;
+    if (out[len-1] == '.') len--;
+    out[len] = '\0';
+  }
+
+  if (len == 2 && out[0] == '-' && out[1] == '0') { // -0 -> 0
+    out[0] = '0';
+    len = 1;
+    out[len] = '\0';
+  }
+
+  return len;
+}
+
+//********************************************************************************
+// Allocate the acquisition buffer once, capacity is rounded up to power of 2
+bool SorbaMqttWifi::setSampleBuffer(uint16_t capacity) {
+  if (sampleRing != NULL) // already allocated
+    return true;
+
+  uint32_t size = 1;
+  while (size < capacity)
+    size <<= 1;
+
+  sampleRing = (tSample*) malloc(size * sizeof(tSample));
+  if (sampleRing == NULL) {
+    Serial.println("Not enough memory for samples buffer");
+    return false;
+  }
+
+  sampleMask = size - 1;
+  sampleHead = 0;
+  sampleTail = 0;
+  sampleOverruns = 0;
+  return true;
+}
+
+//********************************************************************************
+// Add a channel for samples, return its id or -1 if there is no room
+int8_t SorbaMqttWifi::addSampleChannel(char group[], char param[], uint16_t dec) {
+  if (sampleChannels >= MQTT_SAMPLE_CHANNELS) {
+    Serial.println("Samples have no more channels");
+    return -1;
+  }
+
+  tSampleChannel &channel = sampleChannel[sampleChannels];
+  strncpy(channel.group, group, sizeof(channel.group));
+  channel.group[sizeof(channel.group)-1] = '\0';
+  strncpy(channel.param, param, sizeof(channel.param) - 4); // room for _ts
+  channel.param[sizeof(channel.param)-4] = '\0';
+  channel.dec = (dec == 0) ? mqttFloatDecimals : dec;
+
+  return sampleChannels++;
+}
+
+//********************************************************************************
+// Add a sample, safe to call from ISR and from the loop at the same time: no allocation, no JSON and no network
+bool IRAM_ATTR SorbaMqttWifi::pushSample(uint8_t channel, float value) {
+  tSample sample;
+  sample.channel = channel;
+  sample.isFloat = true;
+  sample.value.f = value;
+  return pushSample(sample);
+}
+
+bool IRAM_ATTR SorbaMqttWifi::pushSample(uint8_t channel, double value) {
+  return pushSample(channel, (float) value);
+}
+
+bool IRAM_ATTR SorbaMqttWifi::pushSample(uint8_t channel, int32_t value) {
+  tSample sample;
+  sample.channel = channel;
+  sample.isFloat = false;
+  sample.value.i = value;
+  return pushSample(sample);
+}
+
+bool IRAM_ATTR SorbaMqttWifi::pushSample(tSample &sample) {
+  if (sampleRing == NULL)
+    return false;
+
+  sample.time = millis();
+
+  uint32_t state = sampleLock(); // another ISR or task cannot take the same room
+  uint32_t head = sampleHead;
+  bool full = (head - sampleTail > sampleMask);
+  if (full) // keep the samples already queued
+    sampleOverruns++;
+  else {
+    sampleRing[head & sampleMask] = sample;
+    __sync_synchronize(); // sample is written before it is visible to the loop
+    sampleHead = head + 1;
+  }
+  sampleUnlock(state);
+
+  return !full;
+}
+
+//********************************************************************************
+// Critical section to add samples: interrupts disabled on ESP8266, spinlock for both cores on ESP32
+uint32_t IRAM_ATTR SorbaMqttWifi::sampleLock() {
+#if defined (ESP8266)
+  return xt_rsil(15); // keep the previous interrupt level, it can be called from ISR
+#else
+  portENTER_CRITICAL_SAFE(&sampleMux); // works from ISR or task
+  return 0;
+#endif
+}
+
+void IRAM_ATTR SorbaMqttWifi::sampleUnlock(uint32_t state) {
+#if defined (ESP8266)
+  xt_wsr_ps(state);
+#else
+  portEXIT_CRITICAL_SAFE(&sampleMux);
+#endif
+}
+
+//********************************************************************************
+void SorbaMqttWifi::resetSampleOverruns() {
+  uint32_t state = sampleLock();
+  sampleOverruns = 0;
+  sampleUnlock(state);
+}
+
+//********************************************************************************
+// Pack up to maxSamples queued in one message and send it. Samples are removed only if the message was sent
+uint16_t SorbaMqttWifi::drainSamples(char topic[], uint16_t maxSamples) {
+  if (sampleRing == NULL)
+    return 0;
+
+  uint32_t tail = sampleTail;
+  uint32_t count = sampleHead - tail;
+  __sync_synchronize(); // read samples after head
+  if (count > maxSamples)
+    count = maxSamples;
+  if (count == 0)
+    return 0;
+
+  int      error = lastError; // a batch that is split is not an error
+  uint32_t truncated = memStats.truncated;
+  uint32_t truncPeak = memStats.truncPeak;
+  while (!samplesToMsg(tail, count)) { // too large for MQTT_JSON_LIMIT, try with half of the samples
+    if (count == 1) { // the sample alone does not fit, drop it so the buffer is not blocked
+      __sync_synchronize();
+      sampleTail = tail + 1;
+      uint32_t state = sampleLock();
+      sampleOverruns++;
+      sampleUnlock(state);
+      return 0;
+    }
+    count /= 2;
+  }
+  lastError = error;
+  memStats.truncated = truncated;
+  memStats.truncPeak = truncPeak;
+
+  if (!sendText(topic, mqttMsg))
+    return 0; // keep the samples to try again when connected
+
+  __sync_synchronize(); // samples are read before the ISR can reuse their room
+  sampleTail = tail + count;
+  return count;
+}
+
+//********************************************************************************
+// Pack count samples from tail in the JSON doc and serialize it in mqttMsg, false if the message does not fit
+bool SorbaMqttWifi::samplesToMsg(uint32_t tail, uint32_t count) {
+  msgInit();
+  for (uint32_t i = 0; i < count; i++) {
+    tSample &sample = sampleRing[(tail + i) & sampleMask];
+    if (sample.channel >= sampleChannels)
+      continue;
+
+    tSampleChannel &channel = sampleChannel[sample.channel];
+    char tsParam[MQTT_SAMPLE_NAME];
+    snprintf(tsParam, sizeof(tsParam), "%s_ts", channel.param);
+
+    JsonArray values = msgArrayAdd(channel.group, channel.param);
+    if (sample.isFloat)
+      values.add(roundToDec(sample.value.f, channel.dec));
+    else
+      values.add(sample.value.i);
+    msgArrayAdd(channel.group, tsParam).add(sample.time);
+  }
 
+  return msgToChar();
+}
+
+//********************************************************************************
+// Setup a lane: weight 0 is strict priority, otherwise its share in the weighted round robin
+void SorbaMqttWifi::setLane(uint8_t lane, uint16_t weight, float maxRate, uint16_t burst, uint16_t limit) {
+  if (lane >= MQTT_LANES)
+    return;
+
+  laneWeight[lane]   = weight;
+  laneInterval[lane] = (maxRate > 0) ? (uint32_t) (1000.0 / maxRate) : 0;
+  laneBurst[lane]    = (burst == 0) ? 1 : burst;
+  laneCredit[lane]   = laneInterval[lane] * laneBurst[lane]; // start with the full burst
+  laneRefill[lane]   = millis();
+  laneLimit[lane]    = limit;
+  wrrCredit[lane]    = weight;
+}
+
+//********************************************************************************
+// Queue the JSON message in the lane, need to call first msgInit and msgPack
+bool SorbaMqttWifi::queueMsg(char topic[], uint8_t lane) {
+  if (!msgToChar()) // Serializing the JSON
+    return false;
+
+  return queueText(topic, mqttMsg, lane);
+}
+
+//********************************************************************************
+// Queue a message already serialized in the lane
+bool SorbaMqttWifi::queueText(char topic[], const char msg[], uint8_t lane) {
+  if (lane >= MQTT_LANES)
+    return false;
+
+  tLaneStats &stats = laneStats[lane];
+  if (strlen(msg) >= MQTT_JSON_LIMIT) { // it could never be published, it would block the lane
+    stats.dropped++;
+    lastError = MQTT_ERR_MSG_TRUNCATED;
+    Serial.println("Message too large for outbound lane (MQTT_JSON_LIMIT)");
+    return false;
+  }
+
+  uint16_t count = laneQueue[lane].itemCount();
+  if (count >= laneLimit[lane]) {
+    stats.dropped++;
+    lastError = MQTT_ERR_LANE_FULL;
+    Serial.print("Outbound lane full: "); Serial.println(lane);
+    return false;
+  }
+
+  tOutMsg out;
+  out.topic   = topic;
+  out.payload = msg;
+  out.qos     = mqttQoS;
+  out.time    = millis();
+  if (!laneQueue[lane].enqueue(out)) { // not enough memory
+    stats.dropped++;
+    lastError = MQTT_ERR_LANE_FULL;
+    return false;
+  }
+
+  if (count + 1 > stats.peak)
+    stats.peak = count + 1;
+
+  if (lane == MQTT_LANE_ALARM)
+    sendAlarms();
+
+  return true;
+}
+
+//********************************************************************************
+// Send up to maxMsgs queued by priority. Messages are kept if the connection fails
+uint16_t SorbaMqttWifi::sendQueued(uint16_t maxMsgs) {
+  uint16_t sent = 0;
+
+  while (sent < maxMsgs) {
+    int8_t lane = nextLane();
+    if (lane < 0 || !sendLane(lane))
+      break;
+    sent++;
+  }
+
+  return sent;
+}
+
+//********************************************************************************
+// Send the alarms queued (within its rate limit)
+uint16_t SorbaMqttWifi::sendAlarms() {
+  uint16_t sent = 0;
+
+  while (laneReady(MQTT_LANE_ALARM, millis()) && sendLane(MQTT_LANE_ALARM))
+    sent++;
+
+  return sent;
+}
+
+//********************************************************************************
+// Lane has messages and its rate limit (credit in ms refilled with the time) allows sending
+bool SorbaMqttWifi::laneReady(uint8_t lane, unsigned long now) {
+  if (laneQueue[lane].isEmpty())
+    return false;
+
+  if (laneInterval[lane] == 0) // no rate limit
+    return true;
+
+  uint32_t maxCredit = laneInterval[lane] * laneBurst[lane];
+  laneCredit[lane] += now - laneRefill[lane];
+  laneRefill[lane] = now;
+  if (laneCredit[lane] > maxCredit)
+    laneCredit[lane] = maxCredit;
+
+  if (laneCredit[lane] < laneInterval[lane]) {
+    laneStats[lane].deferred++;
+    return false;
+  }
+
+  return true;
+}
+
+//********************************************************************************
+// Select the lane to send next: strict lanes first by priority, then weighted round robin
+int8_t SorbaMqttWifi::nextLane() {
+  unsigned long now = millis();
+  bool ready[MQTT_LANES];
+
+  for (uint8_t lane = 0; lane < MQTT_LANES; lane++) {
+    ready[lane] = laneReady(lane, now);
+    if (ready[lane] && laneWeight[lane] == 0)
+      return lane;
+  }
+
+  for (uint8_t i = 0; i <= MQTT_LANES; i++) { // the current lane is checked again with new credit after a full round
+    if (ready[wrrLane] && wrrCredit[wrrLane] > 0) {
+      wrrCredit[wrrLane]--;
+      return wrrLane;
+    }
+    wrrLane = (wrrLane + 1) % MQTT_LANES;
+    wrrCredit[wrrLane] = laneWeight[wrrLane];
+  }
+
+  return -1;
+}
+
+//********************************************************************************
+// Send the first message of the lane with its QoS, remove it only if it was sent
+bool SorbaMqttWifi::sendLane(uint8_t lane) {
+  tOutMsg out = laneQueue[lane].getHead();
+
+  uint16_t backupQoS = mqttQoS;
+  mqttQoS = out.qos;
+  bool result = sendText((char*) out.topic.c_str(), (char*) out.payload.c_str());
+  mqttQoS = backupQoS;
+
+  tLaneStats &stats = laneStats[lane];
+  if (!result) {
+    if (isConnected() && ++laneRetry[lane] >= MQTT_LANE_RETRY) { // not a connection problem, drop it so the lane is not blocked
+      laneQueue[lane].dequeue();
+      laneRetry[lane] = 0;
+      stats.failed++;
+      lastError = MQTT_ERR_LANE_FAILED;
+      Serial.print("Message dropped from outbound lane: "); Serial.println(lane);
+    }
+    return false;
+  }
+
+  laneQueue[lane].dequeue();
+  laneRetry[lane] = 0;
+
+  uint32_t wait = millis() - out.time;
+  stats.sent++;
+  stats.totalWait += wait;
+  if (wait > stats.maxWait)
+    stats.maxWait = wait;
+
+  if (laneInterval[lane] > 0)
+    laneCredit[lane] -= laneInterval[lane];
+
+  return true;
+}
+
+//********************************************************************************
+// Metrics of the lane
+tLaneStats SorbaMqttWifi::getLaneStats(uint8_t lane) {
+  tLaneStats stats = {};
+  if (lane >= MQTT_LANES)
+    return stats;
+
+  stats = laneStats[lane];
+  stats.queued = laneQueue[lane].itemCount();
+  return stats;
+}
+
+//********************************************************************************
+// Show in Serial the metrics of each lane
+void SorbaMqttWifi::showLaneStats() {
+  const char *names[MQTT_LANES] = {"alarm", "control", "telemetry"};
+
+  for (uint8_t lane = 0; lane < MQTT_LANES; lane++) {
+    tLaneStats stats = getLaneStats(lane);
+    Serial.print("Lane "); Serial.print(names[lane]);
+    Serial.print(" queued: "); Serial.print(stats.queued);
+    Serial.print(" peak: "); Serial.print(stats.peak);
+    Serial.print(" sent: "); Serial.print(stats.sent);
+    Serial.print(" dropped: "); Serial.print(stats.dropped);
+    Serial.print(" deferred: "); Serial.print(stats.deferred);
+    Serial.print(" failed: "); Serial.print(stats.failed);
+    Serial.print(" wait (ms) avg: "); Serial.print(stats.sent > 0 ? stats.totalWait / stats.sent : 0);
+    Serial.print(" max: "); Serial.println(stats.maxWait);
+  }
+}
+
+//********************************************************************************
+void SorbaMqttWifi::resetLaneStats() {
+  for (uint8_t lane = 0; lane < MQTT_LANES; lane++)
+    laneStats[lane] = tLaneStats();
+}
+
+//********************************************************************************
+// Serialize the JSON doc in mqttMsg. A message that does not fit is not sent, instead of sending a truncated JSON
+bool SorbaMqttWifi::msgToChar() {
+  size_t len = serializeJson (_jsDoc, mqttMsg); // convert from JSON doc to char array
+
+  if (len >= sizeof(mqttMsg) - 1) { // only measure when the buffer is full
+    size_t needed = measureJson(_jsDoc);
+    if (needed >= sizeof(mqttMsg)) {
+      memStats.truncated++;
+      if (needed > memStats.truncPeak)
+        memStats.truncPeak = needed;
+      lastError = MQTT_ERR_MSG_TRUNCATED;
+      Serial.print("JSON message truncated, size needed: "); Serial.println(needed + 1);
+      return false;
+    }
+  }
+
+  if (_jsDoc.overflowed()) { // some values were not added by msgPack
+    memStats.noMemory++;
+    lastError = MQTT_ERR_JSON_NOMEMORY;
+    Serial.println("JSON doc out of memory, values lost");
+    return false;
+  }
+
+  return true;
+}
+
+//********************************************************************************
+// Report messages lost in the receiving queue since last check
+void SorbaMqttWifi::checkQueue() {
+  if (subMsgQueueDropped != queueDroppedSeen) {
+    queueDroppedSeen = subMsgQueueDropped;
+    lastError = MQTT_ERR_QUEUE_FULL;
+  }
+}
+
+//********************************************************************************
+// Take free heap and largest free block (the heap can be fragmented even with enough free memory)
+void SorbaMqttWifi::checkMemory() {
+  uint32_t heapFree = ESP.getFreeHeap();
+#if defined (ESP8266)
+  uint32_t heapBlock = ESP.getMaxFreeBlockSize();
+#else
+  uint32_t heapBlock = ESP.getMaxAllocHeap();
+#endif
+
+  memStats.heapFree  = heapFree;
+  memStats.heapBlock = heapBlock;
+  if (memStats.heapMin == 0 || heapFree < memStats.heapMin)
+    memStats.heapMin = heapFree;
+  if (memStats.heapBlockMin == 0 || heapBlock < memStats.heapBlockMin)
+    memStats.heapBlockMin = heapBlock;
+}
+
+//********************************************************************************
+// Memory high water marks
+tMemStats SorbaMqttWifi::getMemStats() {
+  tMemStats stats = memStats;
+  stats.jsonNow      = jsonAllocator.used;
+  stats.jsonPeak     = jsonAllocator.peak;
+  stats.queuePeak    = subMsgQueuePeak;
+  stats.queueDropped = subMsgQueueDropped;
+  return stats;
+}
+
+//********************************************************************************
+// MQTT_JSON_LIMIT for the largest message sent, received or not sent because it did not fit (size measured),
+// with 25% margin rounded up to 64 bytes
+uint32_t SorbaMqttWifi::suggestJsonLimit() {
+  uint32_t peak = (memStats.msgPeak > memStats.recvPeak) ? memStats.msgPeak : memStats.recvPeak;
+  if (memStats.truncPeak > peak)
+    peak = memStats.truncPeak;
+  if (peak == 0) // nothing seen yet
+    return MQTT_JSON_LIMIT;
+
+  uint32_t limit = peak + 1 + peak / 4; // room for the end of string
+  return (limit + 63) & ~63;
+}
+
+//********************************************************************************
+// MQTT_QUEUE_LIMIT for the peak of the receiving queue with 25% margin
+uint16_t SorbaMqttWifi::suggestQueueLimit() {
+  if (subMsgQueueDropped > 0) // the queue was full
+    return MQTT_QUEUE_LIMIT * 2;
+
+  uint16_t limit = subMsgQueuePeak + subMsgQueuePeak / 4 + 1;
+  return (limit < 2) ? 2 : limit;
+}
+
+//********************************************************************************
+// Show in Serial the high water marks and the sizes suggested
+void SorbaMqttWifi::showMemReport() {
+  checkMemory();
+  tMemStats stats = getMemStats();
+
+  Serial.print("JSON doc (bytes) now: "); Serial.print(stats.jsonNow);
+  Serial.print(" peak: "); Serial.println(stats.jsonPeak);
+  Serial.print("Message (bytes) sent peak: "); Serial.print(stats.msgPeak);
+  Serial.print(" received peak: "); Serial.print(stats.recvPeak);
+  Serial.print(" truncated: "); Serial.print(stats.truncated);
+  Serial.print(" (peak "); Serial.print(stats.truncPeak); Serial.print(")");
+  Serial.print(" no memory: "); Serial.println(stats.noMemory);
+  Serial.print("Receiving queue peak: "); Serial.print(stats.queuePeak);
+  Serial.print(" lost: "); Serial.println(stats.queueDropped);
+  Serial.print("Heap free: "); Serial.print(stats.heapFree);
+  Serial.print(" min: "); Serial.print(stats.heapMin);
+  Serial.print(" largest block: "); Serial.print(stats.heapBlock);
+  Serial.print(" min: "); Serial.println(stats.heapBlockMin);
+  Serial.print("Suggested MQTT_JSON_LIMIT: "); Serial.print(suggestJsonLimit());
+  Serial.print(" (now "); Serial.print(MQTT_JSON_LIMIT); Serial.print(")");
+  Serial.print(" MQTT_QUEUE_LIMIT: "); Serial.print(suggestQueueLimit());
+  Serial.print(" (now "); Serial.print(MQTT_QUEUE_LIMIT); Serial.println(")");
+}
+
+//********************************************************************************
+void SorbaMqttWifi::resetMemStats() {
+  memStats = tMemStats();
+  jsonAllocator.peak = jsonAllocator.used;
+  subMsgQueuePeak = subMsgQueue.itemCount();
+  subMsgQueueDropped = 0;
+  queueDroppedSeen = 0;
+}
+
+//********************************************************************************
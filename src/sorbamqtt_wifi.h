@@ -24,6 +24,7 @@
 #include <ArduinoJson.h>   // For JSON doc handling (V7.3.1) https://arduinojson.org/?utm_source=meta&utm_medium=library.properties
 #include <UUID.h>          // for UUID generator (V0.1.6)    https://github.com/RobTillaart/UUID
 #include <ArduinoQueue.h>  // for Queue operations (V1.2.5)  https://github.com/EinarArnason/ArduinoQueue
+#include <EEPROM.h>        // To keep the Wifi cache for fast reconnect after power cycle
 
 // Global constant definitions for memory size- will impact Global variables %
 #define KB 1024               // Just 1024 for 1 KB
@@ -36,6 +37,51 @@
 #define MQTT_CLIENTID_LIMIT 40 // Limit for MQTT Client ID (Unique ID) Must has enough room to store the UUID, otherwise coud affect the copy
 #define MQTT_QUEUE_LIMIT    20  // Limit for MQTT Queue messages receiving from callback
 
+#define MQTT_CHUNK_LIMIT    1 * KB  // Default size for each chunk message when sending arrays, max MQTT_JSON_LIMIT
+#define MQTT_CHUNK_TRAILER  100 // Room for the chunk info at the end of each chunk message
+#define MQTT_CHUNK_MIN      (MQTT_CHUNK_TRAILER + 64) // Min size for each chunk message, room for the names and some values
+#define MQTT_SAMPLE_LIMIT   128 // Default samples in the acquisition buffer (rounded to power of 2), see setSampleBuffer
+#define MQTT_SAMPLE_CHANNELS  8 // Limit for channels (group/param) of samples
+#define MQTT_SAMPLE_BATCH    32 // Default samples packed in each message by drainSamples
+#define MQTT_SAMPLE_NAME     24 // Limit for group and param names of each channel
+#define MQTT_LANE_LIMIT     10  // Default limit for messages waiting in each outbound lane
+#define MQTT_LANE_RETRY      3  // Times a message can fail while connected before it is dropped from its lane
+#define MQTT_TEMPLATE_LIMIT 512 // Limit for the template message (fixed layout with values), see msgTemplateInit
+#define MQTT_TEMPLATE_SLOTS  32 // Limit for values in the template message
+#define MQTT_TEMPLATE_WIDTH  12 // Default chars reserved for each value in the template message
+
+// Value types for the template message
+#define MQTT_TPL_FLOAT 0
+#define MQTT_TPL_INT   1
+#define MQTT_TPL_BOOL  2
+
+// Outbound lanes, lower number is higher priority
+#define MQTT_LANE_ALARM      0  // Alarms and events, sent as soon as possible
+#define MQTT_LANE_CONTROL    1  // Commands and replies
+#define MQTT_LANE_TELEMETRY  2  // Bulk data
+#define MQTT_LANES           3
+
+// Error codes of the last failure, see GetLastError
+#define MQTT_OK                 0
+#define MQTT_ERR_MSG_TRUNCATED  1  // Serialized JSON does not fit in MQTT_JSON_LIMIT, message not sent
+#define MQTT_ERR_JSON_NOMEMORY  2  // JSON doc ran out of memory, values lost (msgPack) or message not parsed
+#define MQTT_ERR_JSON_INVALID   3  // Received message is not a valid JSON
+#define MQTT_ERR_QUEUE_FULL     4  // Received messages lost because the queue (MQTT_QUEUE_LIMIT) was full
+#define MQTT_ERR_LANE_FULL      5  // Message not queued because the outbound lane was full
+#define MQTT_ERR_LANE_FAILED    6  // Message dropped from its lane after failing MQTT_LANE_RETRY times while connected
+#define MQTT_ERR_ZIP_INVALID    7  // Received compressed payload is not valid or does not fit in MQTT_JSON_LIMIT, message lost
+
+#define WIFI_POLL_TIME      50    // Time in ms between checks of Wifi connection status
+#define WIFI_FAST_TIMEOUT   5000  // Time in ms for fast reconnect before doing full connection
+#define WIFI_CACHE_MAGIC    0x53574331 // Valid Wifi cache mark
+
+// MQTT protocol used for the connection
+#define MQTT_PROTOCOL_V311   4  // MQTT 3.1.1 using PubSubClient (default)
+#define MQTT_PROTOCOL_V5     5  // MQTT 5 with Topic Aliases and persistent sessions
+
+#include "sorbamqtt5.h"    // MQTT 5 client, uses the limits above
+#include "sorbalz.h"       // LZ compression for payloads
+
 typedef void (*callbackMQTT) (char* topic, byte* payload, unsigned int length);
 
 // Global objects created at starting
@@ -43,11 +89,15 @@ typedef void (*callbackMQTT) (char* topic, byte* payload, unsigned int length);
 
 // extern PubSubClient client; // Simple MQTT client
 
-// For JSON smaller than 1KB use StaticJsonDocument, for larger than 1 KB use DynamicJsonDocument
-extern DynamicJsonDocument _jsDoc; // Working with JSON doc for both sending MQTT messages or subscribing
+// JSON doc grows in the heap as needed, its memory is tracked to get the peak (see getMemStats)
+extern JsonDocument _jsDoc; // Working with JSON doc for both sending MQTT messages or subscribing
 
 extern void defCallback(char* topic, byte* payload, unsigned int length);  // Calling back for subscription
 
+extern volatile unsigned long wifiAssocTime; // Time when the station joined the AP (before DHCP)
+
+extern void wifiEventsInit(); // Register Wifi event to get the time when it joins the AP
+
 // Struct for ArduinoQueue messages (When subscribing)
 struct tSubMsg {
   String topic;
@@ -56,6 +106,95 @@ struct tSubMsg {
 
 extern ArduinoQueue<tSubMsg> subMsgQueue; // Queue to receive subscription messages
 
+extern uint16_t subMsgQueuePeak;    // Max messages waiting in the queue
+
+extern uint32_t subMsgQueueDropped; // Messages lost because the queue was full
+
+// Struct for the last Wifi connection used by fast reconnect (AP and IP lease)
+struct tWifiCache {
+  uint32_t magic;     // WIFI_CACHE_MAGIC when it is valid
+  uint8_t  bssid[6];  // AP MAC address
+  int32_t  channel;   // AP channel
+  uint32_t ip;        // IP lease
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+// Struct for the time in ms of each connection phase
+struct tConnTiming {
+  uint32_t wifiJoin;    // Join to the AP (includes DHCP when the Wifi event is not available)
+  uint32_t wifiDhcp;    // Get the IP, 0 with static IP
+  uint32_t netConnect;  // TCP connection, including the TLS handshake when using WiFiClientSecure
+  uint32_t mqttConnect; // MQTT CONNECT and CONNACK
+  bool     fastJoin;    // Connected using the Wifi cache
+};
+
+// Struct for messages waiting in the outbound lanes
+struct tOutMsg {
+  String   topic;
+  String   payload;
+  uint16_t qos;
+  unsigned long time; // millis() when it was queued
+};
+
+// Struct for the metrics of each outbound lane
+struct tLaneStats {
+  uint16_t queued;    // Messages waiting now
+  uint16_t peak;      // Max messages waiting
+  uint32_t sent;
+  uint32_t dropped;   // Messages rejected because the lane was full
+  uint32_t deferred;  // Times the lane was held by its rate limit
+  uint32_t failed;    // Messages dropped after failing MQTT_LANE_RETRY times while connected
+  uint32_t maxWait;   // Max time in ms from queued to sent
+  uint32_t totalWait; // Sum of time in ms from queued to sent, average = totalWait / sent
+};
+
+// Struct for the memory high water marks, see getMemStats and showMemReport
+struct tMemStats {
+  uint32_t jsonNow;      // Bytes of heap used by the JSON doc now
+  uint32_t jsonPeak;     // Max bytes of heap used by the JSON doc
+  uint16_t msgPeak;      // Max length of messages sent (room needed in MQTT_JSON_LIMIT)
+  uint16_t recvPeak;     // Max length of messages received
+  uint16_t queuePeak;    // Max messages waiting in the receiving queue (MQTT_QUEUE_LIMIT)
+  uint32_t queueDropped; // Received messages lost because the queue was full
+  uint32_t truncated;    // Messages not sent because they did not fit in MQTT_JSON_LIMIT
+  uint32_t truncPeak;    // Max length of the messages not sent because they did not fit
+  uint32_t noMemory;     // Times the JSON doc ran out of memory
+  uint32_t heapFree;     // Free heap in last check
+  uint32_t heapMin;      // Min free heap seen
+  uint32_t heapBlock;    // Largest free block in last check
+  uint32_t heapBlockMin; // Min of the largest free block seen
+};
+
+// Struct for each sample in the acquisition buffer (filled from ISR)
+struct tSample {
+  uint32_t time;    // millis() when it was taken
+  uint8_t  channel; // Channel id from addSampleChannel
+  bool     isFloat; // Type of value
+  union {
+    int32_t i;
+    float   f;
+  } value;
+};
+
+// Struct for each channel of samples
+struct tSampleChannel {
+  char     group[MQTT_SAMPLE_NAME];
+  char     param[MQTT_SAMPLE_NAME];
+  uint16_t dec; // Decimals for float values
+};
+
+// Struct for each value in the template message
+struct tTplSlot {
+  uint16_t pos;   // Position of the value in the template
+  uint8_t  width; // Chars reserved for the value
+  uint8_t  dec;   // Decimals for float values
+  uint8_t  type;  // MQTT_TPL_FLOAT, MQTT_TPL_INT or MQTT_TPL_BOOL
+  bool     valid; // Value was written
+  double   last;  // Last value written, to skip writing the same value
+};
+
 
 //SORBA class definition 
 class SorbaMqttWifi
@@ -87,6 +226,20 @@ class SorbaMqttWifi
    
   void setQoS(uint16_t qos) {mqttQoS = qos;}   // Set the Quality of Service for MQTT 
 
+  bool setProtocol(uint8_t protocol); // MQTT_PROTOCOL_V311 (default) or MQTT_PROTOCOL_V5, set it before connect. MQTT 5 client is allocated only when selected
+
+  void setSessionExpiry(uint32_t time) {mqttSessionExpiry = time;} // MQTT 5 only: keep the session (subscriptions) in the broker for time seconds after disconnect
+
+  void setClientID(char clientID[]) { // Use a fixed Client ID instead of random UUID, needed to resume the MQTT 5 session after power cycle
+    strncpy(mqttClientID, clientID, sizeof(mqttClientID));
+    mqttClientID[sizeof(mqttClientID)-1] = '\0';
+    mqttFixedClientID = true;
+  }
+
+  bool sessionPresent() {return (mqttProtocol == MQTT_PROTOCOL_V5) && client5->sessionPresent();} // MQTT 5 only: broker resumed the session, subscriptions are kept
+
+  int32_t GetTotalBytesSaved() {return (client5 == NULL) ? 0 : client5->getAliasBytesSaved();} // MQTT 5 only: total bytes saved by Topic Aliases
+
   // Wifi methods
    bool connectWifi(char wifi_ssid[], char wifi_pwd[]);  // Set the parameters and connect to the Wifi
 
@@ -104,6 +257,23 @@ class SorbaMqttWifi
    
    uint16_t scanWifiNetwork();  // Scan all SSID available from Wifi and show in the Serial port
 
+   // Fast reconnect: join directly the last AP (BSSID, channel) and reuse the IP lease, it falls back to full connection if it fails
+   void setFastReconnect(bool enable, bool staticIP=false, int eepromAddr=-1);
+
+   tWifiCache getWifiCache() {return wifiCache;} // Last AP and IP lease, to keep it in other storage (e.g: RTC memory)
+
+   void setWifiCache(tWifiCache cache) {wifiCache = cache;} // Restore the last AP and IP lease
+
+   tConnTiming getConnTiming() {return connTiming;} // Time of each phase in the last Wifi and MQTT connection
+
+   void showConnTiming(); // Show in Serial the time of each connection phase
+
+#if defined (ESP8266)
+   void setTlsSession(BearSSL::WiFiClientSecure &secureClient) { // Keep the TLS session, reconnecting resumes it instead of full handshake
+     secureClient.setSession(&tlsSession);
+   }
+#endif
+
   
    // WiFiClient* getWifiClient() {return &wifiClient;};   // Get the wifi client object
 
@@ -111,7 +281,7 @@ class SorbaMqttWifi
 
    double roundToDec( double in_value, uint16_t decimal_place=2);
 
-   DynamicJsonDocument jsMsg() { // Return JSON doc used internally for sending or receiving MQTT to allow application work directely with it
+   JsonDocument jsMsg() { // Return JSON doc used internally for sending or receiving MQTT to allow application work directely with it
     return _jsDoc;
    }
    
@@ -184,30 +354,118 @@ class SorbaMqttWifi
    void msgPack(char group[], char param[], String value) { // Setup the Msg parameter for string
       _jsDoc[group][param] = value;
    }
-   /*  // TO DO: Including array 
-   void msgPack(char group[], char param[], float arr[]) { // Setup the Msg parameter for chars
-	 uint32_t total = sizeof(arr)/sizeof(arr[0]);
-	 JsonArray values = _jsonDoc.to<JsonArray>();
-	 for (uint32_t i=0; i<total; i++)
+   void msgPack(char group[], char param[], const int arr[], uint32_t len) { // Setup the Msg parameter for int array
+     JsonArray values = msgArray(group, param);
+     for (uint32_t i=0; i<len; i++)
       values.add(arr[i]);
    }
-   
-   void msgPack(char group[], char param[], double arr[]) { // Setup the Msg parameter for chars
-     JsonArray values = _jsonDoc.to<JsonArray>();
-	 for (double value :arr)
-      values.add(value);
+
+   void msgPack(char group[], char param[], const float arr[], uint32_t len, uint16_t dec=0) { // Setup the Msg parameter for float array with decimal places
+     if (dec==0) dec = mqttFloatDecimals;
+     JsonArray values = msgArray(group, param);
+     for (uint32_t i=0; i<len; i++)
+      values.add(roundToDec(arr[i], dec));
    }
-   
-   void msgPack(char group[], char param[], int arr[]) { // Setup the Msg parameter for chars
-      JsonArray values = _jsonDoc.to<JsonArray>();
-	 for (int value :arr)
-      values.add(value);
+
+   void msgPack(char group[], char param[], const double arr[], uint32_t len, uint16_t dec=0) { // Setup the Msg parameter for double array with decimal places
+     if (dec==0) dec = mqttFloatDecimals;
+     JsonArray values = msgArray(group, param);
+     for (uint32_t i=0; i<len; i++)
+      values.add(roundToDec(arr[i], dec));
    }
-   */
-   void msgToChar() {
-    serializeJson (_jsDoc, mqttMsg); // convert from JSON doc to char array, make sure the array has enough buffer
+
+   // Send large arrays (e.g: waveforms) without JSON doc, split in chunks of setChunkSize bytes when needed, e.g:
+   //  {"PV":{"wave":[1.25,1.3,...]},"chunk":{"id":3,"seq":0,"offset":0,"length":1024,"last":false}}
+   // Arrays that fit in one message are sent without chunk, e.g: {"PV":{"wave":[1.25,1.3]}}
+   bool sendArray(char topic[], char group[], char param[], const int arr[], uint32_t len) {
+     return sendArrayChunks(topic, group, param, arr, len, 0);
+   }
+
+   bool sendArray(char topic[], char group[], char param[], const float arr[], uint32_t len, uint16_t dec=0) {
+     return sendArrayChunks(topic, group, param, arr, len, dec==0 ? mqttFloatDecimals : dec);
+   }
+
+   bool sendArray(char topic[], char group[], char param[], const double arr[], uint32_t len, uint16_t dec=0) {
+     return sendArrayChunks(topic, group, param, arr, len, dec==0 ? mqttFloatDecimals : dec);
+   }
+
+   // Acquisition buffer: samples are added from ISR or callbacks without touching JSON or network,
+   // and drainSamples packs them in messages from the loop, e.g: {"PV":{"temp":[12.5,12.6],"temp_ts":[1000,1010]}}
+   bool setSampleBuffer(uint16_t capacity=MQTT_SAMPLE_LIMIT); // Allocate the buffer once, capacity is rounded up to power of 2
+
+   int8_t addSampleChannel(char group[], char param[], uint16_t dec=0); // Add a channel, return its id or -1 if there is no room
+
+   bool pushSample(uint8_t channel, float value); // Add a sample, safe to call from ISR. Return false if the buffer is full (overrun)
+
+   bool pushSample(uint8_t channel, int32_t value); // Add a sample, safe to call from ISR. Return false if the buffer is full (overrun)
+
+   bool pushSample(uint8_t channel, double value); // Stored as float, so expressions like analogRead(A0) * 0.1 can be used from the loop (not from ISR)
+
+   template <typename T> inline __attribute__((always_inline)) bool pushSample(uint8_t channel, T value) { // Other integer types (int, long, uint16_t ...), int32_t is long on ESP32 core 3.x
+     return pushSample(channel, (int32_t) value);
    }
 
+   uint16_t drainSamples(char topic[], uint16_t maxSamples=MQTT_SAMPLE_BATCH); // Send up to maxSamples queued in one message, return samples sent
+
+   uint32_t GetSamplesQueued() {return sampleHead - sampleTail;} // Samples waiting to be sent
+
+   uint32_t GetSampleOverruns() {return sampleOverruns;} // Samples lost because the buffer was full
+
+   void resetSampleOverruns();
+
+   // Outbound lanes: messages are queued by priority (alarm, control, telemetry) and sent by sendQueued from the loop
+   // Lanes with weight 0 are served first in strict priority, the others share the rest by weighted round robin
+   void setLane(uint8_t lane, uint16_t weight, float maxRate=0, uint16_t burst=1, uint16_t limit=MQTT_LANE_LIMIT); // maxRate in messages/s, 0: no limit
+
+   bool queueMsg(char topic[], uint8_t lane=MQTT_LANE_TELEMETRY); // Queue the JSON message, alarms are sent at once if possible
+
+   bool queueText(char topic[], const char msg[], uint8_t lane=MQTT_LANE_TELEMETRY); // Queue a message already serialized
+
+   uint16_t sendQueued(uint16_t maxMsgs=MQTT_LANE_LIMIT); // Send up to maxMsgs queued by priority, return messages sent
+
+   uint16_t sendAlarms(); // Send the alarms queued, it is also done between chunks of large arrays
+
+   tLaneStats getLaneStats(uint8_t lane);
+
+   void showLaneStats(); // Show in Serial the metrics of each lane
+
+   void resetLaneStats();
+
+   void setChunkSize(uint16_t size) { // Max size in bytes of each chunk message sent by sendArray
+     if (size > MQTT_JSON_LIMIT)
+      size = MQTT_JSON_LIMIT;
+     if (size < MQTT_CHUNK_MIN) // the room for values is chunkSize - MQTT_CHUNK_TRAILER
+      size = MQTT_CHUNK_MIN;
+     chunkSize = size;
+   }
+
+   // Template message: the structure is serialized once, next cycles only write the values that changed, e.g:
+   //  msgTemplateInit(); slot = msgTemplateAdd("PV", "temp", MQTT_TPL_FLOAT, 2);  (once)
+   //  msgTemplateSet(slot, 12.5); sendTemplateMsg(topic);                       (each cycle)
+   void msgTemplateInit(); // Clear the template to add the values again
+
+   int16_t msgTemplateAdd(char group[], char param[], uint8_t type=MQTT_TPL_FLOAT, uint16_t dec=0, uint8_t width=MQTT_TEMPLATE_WIDTH); // Add a value, return its slot
+
+   bool msgTemplateSet(int16_t slot, double value); // Write the value in its slot if it changed
+
+   bool msgTemplateSet(int16_t slot, float value) {return msgTemplateSet(slot, (double) value);}
+
+   bool msgTemplateSet(int16_t slot, int value) {return msgTemplateSet(slot, (double) value);}
+
+   bool msgTemplateSet(int16_t slot, unsigned int value) {return msgTemplateSet(slot, (double) value);}
+
+   bool msgTemplateSet(int16_t slot, long value) {return msgTemplateSet(slot, (double) value);}
+
+   bool msgTemplateSet(int16_t slot, unsigned long value) {return msgTemplateSet(slot, (double) value);}
+
+   bool msgTemplateSet(int16_t slot, bool value) {return msgTemplateSet(slot, (double) value);}
+
+   char* msgTemplate() {return mqttTpl;} // Template message with the current values
+
+   bool sendTemplateMsg(char topic[]); // Send the template message with the current values
+
+   bool msgToChar(); // Serialize the JSON doc in mqttMsg, false if it does not fit or values were lost (see GetLastError)
+
    bool sendMsg(char topic[]); // Send the message with default QoS, need to call first msgInit and msgPack
    
    bool sendMsg(char topic[], uint16_t mqtt_qos); // Send the message with custom QoS , need to call first msgInit and msgPack
@@ -219,6 +477,27 @@ class SorbaMqttWifi
    uint32_t GetTotalPackSent(){return totalPackSent;}; // Get the total of packages sent
    
    uint32_t GetTotalPackRecv(){return totalPackRecv;}; // Get the total of packages received
+
+   uint32_t GetTotalZipSaved(){return totalZipSaved;}; // Get the total of bytes saved by compression when sending
+
+   int GetLastError() {return lastError;} // Code of the last failure (MQTT_ERR_*), MQTT_OK if none
+
+   void clearLastError() {lastError = MQTT_OK;}
+
+   // Memory high water marks to size MQTT_JSON_LIMIT and MQTT_QUEUE_LIMIT with real traffic
+   tMemStats getMemStats();
+
+   void checkMemory(); // Take free heap and largest free block, it is done in each message sent or received
+
+   uint32_t suggestJsonLimit(); // MQTT_JSON_LIMIT for the largest message seen (sent, received or truncated) with 25% margin
+
+   uint16_t suggestQueueLimit(); // MQTT_QUEUE_LIMIT for the peak of the queue seen with 25% margin
+
+   void showMemReport(); // Show in Serial the high water marks and the sizes suggested
+
+   void resetMemStats();
+
+   bool setCompression(bool enable, uint16_t minSize=SORBA_LZ_MIN_SIZE); // Compress sent payloads larger than minSize, received compressed payloads are always decompressed
    
    bool parseMsg(String msg); // Parse the JSON from string, after can extract parameter values using msgUnpack
 
@@ -337,8 +616,31 @@ class SorbaMqttWifi
       value = _jsDoc[group][param].as<String>();
    }
 
+   // Transfer the array to arr, return total values copied. Chunks are copied at their offset, so arr can be
+   // filled with all chunks received, use msgArrayComplete to check if all chunks were received
+   uint32_t msgUnpack(char group[], char param[], int arr[], uint32_t maxLen) {
+     return unpackArray(group, param, arr, maxLen);
+   }
+
+   uint32_t msgUnpack(char group[], char param[], float arr[], uint32_t maxLen) {
+     return unpackArray(group, param, arr, maxLen);
+   }
+
+   uint32_t msgUnpack(char group[], char param[], double arr[], uint32_t maxLen) {
+     return unpackArray(group, param, arr, maxLen);
+   }
+
+   bool msgArrayComplete() { // All chunks of the array were received in order
+     return rxChunkOk && rxChunkCount >= rxChunkLength;
+   }
+
+   uint32_t msgArrayLength() {return rxChunkLength;} // Total values of the array being received
+
    void subscribe(char topic[]) { // Subscribe to a topic
-    client.subscribe(topic);
+    if (mqttProtocol == MQTT_PROTOCOL_V5)
+     client5->subscribe(topic, mqttQoS);
+    else
+     client.subscribe(topic);
    }
 
    void setCallback(callbackMQTT acallback) {
@@ -368,9 +670,149 @@ class SorbaMqttWifi
    }
 
   private:
+   JsonArray msgArray(char group[], char param[]) { // Create the array in the JSON doc
+     if (strlen(group) ==0) // check if there is no group
+      return _jsDoc[param].to<JsonArray>();
+     return _jsDoc[group][param].to<JsonArray>();
+   }
+
+   bool pushSample(tSample &sample); // Add the sample at head if there is room
+
+   bool samplesToMsg(uint32_t tail, uint32_t count); // Pack samples in mqttMsg, false if they do not fit
+
+   uint32_t sampleLock(); // Enter the critical section to add samples, also from ISR
+
+   void sampleUnlock(uint32_t state); // Leave the critical section with the state returned by sampleLock
+
+   void checkQueue(); // Report messages lost in the receiving queue
+
+   bool laneReady(uint8_t lane, unsigned long now); // Lane has messages and its rate limit allows sending
+
+   int8_t nextLane(); // Select the lane to send next, -1 if none
+
+   bool sendLane(uint8_t lane); // Send the first message of the lane
+
+   JsonArray msgArrayAdd(char group[], char param[]) { // Get the array in the JSON doc, create it if it does not exist
+     JsonArray values = (strlen(group) == 0) ? _jsDoc[param].as<JsonArray>() : _jsDoc[group][param].as<JsonArray>();
+     if (values.isNull())
+      values = msgArray(group, param);
+     return values;
+   }
+
+   uint16_t formatValue(char out[], int value, uint16_t dec); // Write the value as text, return the length
+
+   uint16_t formatValue(char out[], double value, uint16_t dec); // Write the value as text with decimals (no trailing zeros)
+
+   uint16_t formatValue(char out[], float value, uint16_t dec) {return formatValue(out, (double) value, dec);}
+
+   template <typename T> bool sendArrayChunks(char topic[], char group[], char param[], const T arr[], uint32_t len, uint16_t dec) {
+     uint32_t limit = chunkSize - MQTT_CHUNK_TRAILER; // room for the chunk info
+     uint32_t i = 0;
+     uint32_t seq = 0;
+     chunkId++;
+
+     do {
+      uint32_t start = i;
+      uint32_t pos;
+      if (strlen(group) == 0)
+       pos = snprintf(mqttMsg, limit, "{\"%s\":[", param);
+      else
+       pos = snprintf(mqttMsg, limit, "{\"%s\":{\"%s\":[", group, param);
+
+      if (pos + 2 >= limit) {
+       Serial.println("Array chunk size is too small");
+       return false;
+      }
+
+      while (i < len) { // fill the chunk, at least one value each chunk
+       char text[32];
+       uint16_t n = formatValue(text, arr[i], dec);
+       if (i > start && pos + n + 1 > limit)
+        break;
+       if (i > start) mqttMsg[pos++] = ',';
+       memcpy(mqttMsg + pos, text, n);
+       pos += n;
+       i++;
+      }
+
+      bool last = (i >= len);
+      pos += snprintf(mqttMsg + pos, sizeof(mqttMsg) - pos, (strlen(group) == 0) ? "]" : "]}");
+      if (seq == 0 && last) // one message, no chunk needed
+       snprintf(mqttMsg + pos, sizeof(mqttMsg) - pos, "}");
+      else
+       snprintf(mqttMsg + pos, sizeof(mqttMsg) - pos, ",\"chunk\":{\"id\":%lu,\"seq\":%lu,\"offset\":%lu,\"length\":%lu,\"last\":%s}}",
+                (unsigned long) chunkId, (unsigned long) seq, (unsigned long) start, (unsigned long) len, last ? "true" : "false");
+
+      sendAlarms(); // alarms are not kept waiting behind the whole array
+      if (!sendText(topic, mqttMsg))
+       return false;
+      seq++;
+     } while (i < len);
+
+     return true;
+   }
+
+   template <typename T> uint32_t unpackArray(char group[], char param[], T arr[], uint32_t maxLen) {
+     JsonArray values = (strlen(group) == 0) ? _jsDoc[param].as<JsonArray>() : _jsDoc[group][param].as<JsonArray>();
+     uint32_t offset = 0;
+
+     if (_jsDoc["chunk"].isNull()) { // whole array in one message
+      rxChunkLength = values.size();
+      rxChunkCount = 0;
+      rxChunkOk = true;
+     }
+     else {
+      uint32_t id  = _jsDoc["chunk"]["id"];
+      uint32_t seq = _jsDoc["chunk"]["seq"];
+      offset = _jsDoc["chunk"]["offset"];
+      if (seq == 0 || id != rxChunkId) { // new array
+       rxChunkId = id;
+       rxChunkLength = _jsDoc["chunk"]["length"];
+       rxChunkCount = 0;
+       rxChunkSeq = 0;
+       rxChunkOk = true;
+      }
+      if (seq != rxChunkSeq) // missing chunk
+       rxChunkOk = false;
+      rxChunkSeq = seq + 1;
+     }
+
+     uint32_t copied = 0;
+     for (JsonVariant value : values) {
+      if (offset + copied >= maxLen) {
+       rxChunkOk = false; // arr is too small
+       break;
+      }
+      arr[offset + copied] = value.as<T>();
+      copied++;
+     }
+
+     rxChunkCount += copied;
+     return copied;
+   }
+
+   bool waitWifi(unsigned long timeout); // Wait for Wifi connection up to timeout ms (0: forever)
+
+   void wifiCacheUpdate(); // Keep the current AP and IP lease
+
+   bool mqttLoop(); // Process the MQTT client (callback when subscribing and keep alive) for the protocol selected
+
+   bool mqttPublish(char topic[], const uint8_t payload[], unsigned int length); // Publish using the MQTT client for the protocol selected
+
+   bool sendText(char topic[], char msg[]); // Send a message already serialized, checking Wifi and MQTT connections first
+
+   uint16_t msgCompress(char msg[]); // Compress msg into mqttZip, return the compressed size or 0 to send it as is
+
+   bool msgInflate(String &payload); // Decompress the payload if it is compressed, return false if it is not valid
+
   // Attributes
  
    PubSubClient client; // MQTT Client
+   Client*  netClient;  // Network client (WifiClient or WiFiClientSecure) used by the MQTT client
+   SorbaMqtt5Client *client5 = NULL; // MQTT 5 Client, allocated by setProtocol(MQTT_PROTOCOL_V5), so MQTT 3.1.1 does not use its memory
+   uint8_t  mqttProtocol = MQTT_PROTOCOL_V311;
+   uint32_t mqttSessionExpiry = 0; // MQTT 5 Session Expiry in seconds
+   bool     mqttFixedClientID = false; // Client ID set by setClientID, not generated
    unsigned long startTime; // For checking elapsed time
    unsigned long timems = 5000;  // Time in ms for checking the timer
    
@@ -387,6 +829,9 @@ class SorbaMqttWifi
    uint16_t mqttFloatDecimals = 2;
    uint32_t totalPackSent =0;
    uint32_t totalPackRecv =0;
+   int      lastError = MQTT_OK;
+   tMemStats memStats = {};
+   uint32_t queueDroppedSeen = 0; // Messages lost in the queue already reported in lastError
 
    // Used for callback when subscribing to MQTT messages
    callbackMQTT callback = NULL; 
@@ -394,9 +839,65 @@ class SorbaMqttWifi
    // Use for serialize the JSON into char*
    char     mqttMsg[MQTT_JSON_LIMIT]; // Limit the MQTT MSG Limit, this is to avoid Strings to minimize the fragmentation of the heap memory if we were using String class
 
+   // Arrays sent or received in chunks
+   uint16_t chunkSize = MQTT_CHUNK_LIMIT;
+   uint32_t chunkId = 0;
+   uint32_t rxChunkId = 0;
+   uint32_t rxChunkSeq = 0;
+   uint32_t rxChunkLength = 0;
+   uint32_t rxChunkCount = 0;
+   bool     rxChunkOk = false;
+
+   // Outbound lanes
+   ArduinoQueue<tOutMsg> laneQueue[MQTT_LANES]; // Limit is checked with laneLimit
+   tLaneStats laneStats[MQTT_LANES] = {};
+   uint16_t laneLimit[MQTT_LANES]    = {MQTT_LANE_LIMIT, MQTT_LANE_LIMIT, MQTT_LANE_LIMIT};
+   uint16_t laneWeight[MQTT_LANES]   = {0, 0, 0}; // All strict priority by default
+   uint32_t laneInterval[MQTT_LANES] = {0, 0, 0}; // Rate limit: ms per message, 0: no limit
+   uint32_t laneBurst[MQTT_LANES]    = {1, 1, 1}; // Messages that can be sent together after being idle
+   uint32_t laneCredit[MQTT_LANES]   = {0, 0, 0}; // Rate limit credit in ms
+   unsigned long laneRefill[MQTT_LANES] = {0, 0, 0};
+   uint16_t wrrCredit[MQTT_LANES]    = {0, 0, 0}; // Messages left for each lane in this round
+   uint8_t  wrrLane = 0;
+   uint8_t  laneRetry[MQTT_LANES]    = {0, 0, 0}; // Failures of the first message of each lane while connected
+
+   // Acquisition buffer: ISR writes at head, loop reads at tail. Counters are free running, index = counter & sampleMask
+   tSample  *sampleRing = NULL;
+   uint32_t sampleMask = 0;
+   volatile uint32_t sampleHead = 0;
+   volatile uint32_t sampleTail = 0;
+   volatile uint32_t sampleOverruns = 0;
+#if !defined (ESP8266)
+   portMUX_TYPE sampleMux = portMUX_INITIALIZER_UNLOCKED; // Protects head and overruns when several ISR or tasks add samples
+#endif
+   uint8_t  sampleChannels = 0;
+   tSampleChannel sampleChannel[MQTT_SAMPLE_CHANNELS];
+
+   // Template message with fixed room for each value
+   char     mqttTpl[MQTT_TEMPLATE_LIMIT] = "{}";
+   uint16_t mqttTplLen = 2;
+   uint16_t mqttTplSlots = 0;
+   tTplSlot tplSlot[MQTT_TEMPLATE_SLOTS];
+
+   // Used for compression, the buffer is allocated only once when compression is enabled
+   uint8_t  *mqttZip = NULL;
+   bool     mqttZipEnabled = false;
+   uint16_t mqttZipMinSize = SORBA_LZ_MIN_SIZE;
+   uint32_t totalZipSaved = 0;
+
    char wifiSSID[WIFI_SSID_LIMIT];
    char wifiPwd[WIFI_PWD_LIMIT];
 
+   // Fast reconnect
+   bool       wifiFastEnabled = false;
+   bool       wifiFastStaticIP = false;
+   int        wifiCacheAddr = -1; // EEPROM address, -1: not saved
+   tWifiCache wifiCache = {0};
+   tConnTiming connTiming = {0};
+#if defined (ESP8266)
+   BearSSL::Session tlsSession; // TLS session kept for resumption
+#endif
+
    
 };  // SorbaMqttWifi Class end definition
 